@@ -0,0 +1,33 @@
+#include "AllocCount.hpp"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef VOLUND_ALLOC_COUNT
+static thread_local size_t count = 0;
+
+void* operator new(std::size_t size) {
+    count++;
+    if (auto ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+#endif
+
+size_t alloccount::thisThread() {
+#ifdef VOLUND_ALLOC_COUNT
+    return count;
+#else
+    return 0;
+#endif
+}
+
+void* alloccount::countedMalloc(size_t size) {
+#ifdef VOLUND_ALLOC_COUNT
+    count++;
+#endif
+    return std::malloc(size);
+}
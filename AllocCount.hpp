@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+// Builds configured with -Dalloc_count=true (VOLUND_ALLOC_COUNT) count every operator new, and
+// every allocation made through countedMalloc, on each thread; otherwise the counts stay 0.
+// Only reported (STATS, VOLUND_BENCH_FRAMES), never asserted on: code we don't own, like a GL
+// driver, can allocate on our threads, and SDL's and libc's own mallocs aren't counted at all.
+namespace alloccount {
+#ifdef VOLUND_ALLOC_COUNT
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+size_t thisThread();
+
+// malloc for C allocator hooks (nuklear's) that should show up in the count too
+void* countedMalloc(size_t size);
+}
@@ -1,16 +1,88 @@
 #include "AppDB.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <filesystem>
 #include "yaip.hpp"
-#include <fstream>
+#include <sstream>
+
+// Exec= per the desktop entry spec: undo the key-file escapes, split on unquoted whitespace,
+// unescape inside double quotes, and expand or drop the field codes. Done once at load time
+// so launching never needs a shell.
+static std::vector<std::string> parseExec(const std::string& raw, const std::string& name, const std::string& icon) {
+  std::string exec;
+  for (size_t i = 0; i < raw.size(); i++) {
+    if (raw[i] != '\\' || i + 1 == raw.size()) {
+      exec += raw[i];
+      continue;
+    }
+    switch (raw[++i]) {
+    case 's': exec += ' '; break;
+    case 'n': exec += '\n'; break;
+    case 't': exec += '\t'; break;
+    case 'r': exec += '\r'; break;
+    case '\\': exec += '\\'; break;
+    default: exec += '\\'; exec += raw[i];
+    }
+  }
+
+  std::vector<std::string> argv;
+  std::string              arg;
+  bool                     inArg = false, quoted = false;
+  for (size_t i = 0; i < exec.size(); i++) {
+    char c = exec[i];
+    if (quoted) {
+      if (c == '"')
+        quoted = false;
+      else if (c == '\\' && i + 1 < exec.size() && std::strchr("\"`$\\", exec[i + 1]))
+        arg += exec[++i];
+      else
+        arg += c;
+    } else if (c == '"') {
+      quoted = inArg = true;
+    } else if (std::isspace((unsigned char)c)) {
+      if (inArg)
+        argv.push_back(std::move(arg));
+      arg.clear();
+      inArg = false;
+    } else if (c == '%' && i + 1 < exec.size()) {
+      // A lone %i becomes two arguments, so it has to be handled at the token level
+      char code = exec[++i];
+      if (code == '%')
+        arg += '%';
+      else if (code == 'c')
+        arg += name;
+      else if (code == 'i' && !inArg && !icon.empty() && (i + 1 == exec.size() || std::isspace((unsigned char)exec[i + 1]))) {
+        argv.push_back("--icon");
+        argv.push_back(icon);
+        continue;
+      }
+      // Everything else is a file/URL list we never have, or deprecated
+      inArg = inArg || !arg.empty();
+      continue;
+    } else {
+      arg += c;
+      inArg = true;
+    }
+  }
+  if (inArg)
+    argv.push_back(std::move(arg));
+  return argv;
+}
 
 void AppDB::addApps(AppList &apps, std::string path) {
+  std::vector<std::string> files, contents;
   for (auto& f : std::filesystem::directory_iterator(path)) {
-    if (!f.is_regular_file())
-      continue;
+    if (f.is_regular_file())
+      files.push_back(f.path());
+  }
 
+  loadFiles(files, contents, loadMethod);
+
+  for (auto& content : contents) {
     INIFile ini;
-    auto    file = std::ifstream(f.path());
+    auto    file = std::istringstream(content);
     ini.parse(file);
 
     auto& entry = ini["Desktop Entry"];
@@ -29,7 +101,11 @@ void AppDB::addApps(AppList &apps, std::string path) {
     if (name.empty() || exec.empty())
       continue;
 
-    apps.insert({name, exec});
+    auto argv = parseExec(entry["Exec"], name, entry["Icon"]);
+    if (argv.empty())
+      continue;
+
+    apps.insert({name, {exec, entry["Icon"], App::Kind::Desktop, std::move(argv), entry["Path"]}});
   }
 }
 
@@ -42,3 +118,36 @@ bool AppDB::replace(std::string &str, const std::string &from, const std::string
   str.replace(start_pos, from.length(), to);
   return true;
 }
+
+static std::string lowered(std::string str) {
+  std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return std::tolower(c); });
+  return str;
+}
+
+void AppDB::buildIndex() const {
+  index.clear();
+  index.reserve(db.size());
+  for (auto& app : db)
+    index.push_back({lowered(app.first), &app});
+
+  std::stable_sort(index.begin(), index.end(), [](auto& a, auto& b) { return a.second->second.kind < b.second->second.kind; });
+  indexDirty = false;
+}
+
+void AppDB::search(const std::string& query, std::vector<AppList::const_pointer>& out) const {
+  if (indexDirty)
+    buildIndex();
+
+  out.clear();
+  if (query.empty()) {
+    for (auto& entry : index)
+      if (entry.second->second.kind == App::Kind::Desktop)
+        out.push_back(entry.second);
+    return;
+  }
+
+  auto needle = lowered(query);
+  for (auto& entry : index)
+    if (entry.first.find(needle) != std::string::npos)
+      out.push_back(entry.second);
+}
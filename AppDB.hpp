@@ -1,9 +1,26 @@
 #pragma once
 
+#include <cstdint>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
+#include "FileLoader.hpp"
 
-using AppList = std::unordered_map<std::string, std::string>;
+
+struct App {
+    enum class Kind : uint8_t { Desktop, Executable };
+
+    std::string exec;
+    std::string icon;
+    Kind        kind = Kind::Desktop;
+
+    // Exec= already split into arguments, and Path= (empty means inherit ours)
+    std::vector<std::string> argv;
+    std::string              cwd;
+};
+
+using AppList = std::unordered_map<std::string, App>;
 
 
 
@@ -13,10 +30,19 @@ public:
     AppDB(){}
     void addPath(const std::string& path) {
         addApps(db, path);
+        indexDirty = true;
+    }
+
+    // Never replaces an existing entry, so load desktop entries before anything else
+    void add(const std::string& name, App app) {
+        db.insert({name, std::move(app)});
+        indexDirty = true;
     }
 
     void clear() {
         db.clear();
+        index.clear();
+        indexDirty = true;
     }
 
     unsigned numApps() {
@@ -27,9 +53,20 @@ public:
         return db;
     }
 
+    // Case-insensitive substring match, desktop entries ranked above bare executables.
+    // An empty query lists desktop entries only.
+    void search(const std::string& query, std::vector<AppList::const_pointer>& out) const;
+
+    LoadMethod loadMethod = LoadMethod::Auto;
+
 private:
     AppList db;
 
+    // Lowercased names, sorted by kind so a single pass yields results in rank order
+    mutable std::vector<std::pair<std::string, AppList::const_pointer>> index;
+    mutable bool                                                         indexDirty = true;
+    void buildIndex() const;
+
     bool replace(std::string& str, const std::string& from, const std::string& to);
     void addApps(AppList& apps, std::string path);
 
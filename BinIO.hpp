@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+// Native-endian helpers for volund's own cache files. They're only ever read back on the machine that wrote them.
+namespace binio {
+template <typename T> inline void write(std::ostream& out, T val) { out.write(reinterpret_cast<const char*>(&val), sizeof(T)); }
+
+inline void writeStr(std::ostream& out, const std::string& str) {
+    write<uint32_t>(out, str.size());
+    out.write(str.data(), str.size());
+}
+
+template <typename T> inline bool read(std::istream& in, T& val) { return bool(in.read(reinterpret_cast<char*>(&val), sizeof(T))); }
+
+inline bool readStr(std::istream& in, std::string& str) {
+    uint32_t len;
+    if (!read(in, len) || len > (1u << 16))
+        return false;
+    str.resize(len);
+    return bool(in.read(&str[0], len));
+}
+} // namespace binio
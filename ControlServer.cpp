@@ -0,0 +1,105 @@
+#include "ControlServer.hpp"
+
+#include <cstring>
+#include <iostream>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static bool readAll(int fd, void* buf, size_t len) {
+    auto bytes = static_cast<char*>(buf);
+    while (len) {
+        auto n = read(fd, bytes, len);
+        if (n <= 0)
+            return false;
+        bytes += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool writeAll(int fd, const void* buf, size_t len) {
+    auto bytes = static_cast<const char*>(buf);
+    while (len) {
+        auto n = send(fd, bytes, len, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        bytes += n;
+        len -= n;
+    }
+    return true;
+}
+
+ControlServer::ControlServer(EventLoop& loop, Handler handler) : loop{loop}, handler{std::move(handler)} {
+    char buf[sizeof(sockaddr_un::sun_path)];
+    volund_socket_path(buf, sizeof(buf));
+    path = buf;
+
+    sockaddr_un addr = {};
+    addr.sun_family  = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return;
+
+    // Only clear the socket out of the way if nobody is answering on it
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+        std::cerr << "Another volund is already listening on " << path << "; not taking over its socket\n";
+        close(fd);
+        return;
+    }
+    close(fd);
+    unlink(path.c_str());
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    auto oldMask = umask(0077);
+    bool ok      = fd >= 0 && bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 && listen(fd, 8) == 0;
+    umask(oldMask);
+    if (!ok) {
+        std::cerr << "Couldn't listen on " << path << ": " << strerror(errno) << '\n';
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+
+    listenFd = fd;
+    loop.watch(listenFd, [this] { accept(); });
+}
+
+ControlServer::~ControlServer() {
+    if (listenFd < 0)
+        return;
+    loop.unwatch(listenFd);
+    close(listenFd);
+    unlink(path.c_str());
+}
+
+// Requests are a few bytes and the client sends them straight after connecting, so each one is
+// handled to completion here rather than buffered across loop iterations. The timeout keeps a
+// stuck client from wedging the daemon.
+void ControlServer::accept() {
+    int client;
+    while ((client = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC)) >= 0) {
+        timeval timeout = {0, 200000};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        volund_msg_header req;
+        std::string       payload;
+        if (readAll(client, &req, sizeof(req)) && req.length <= VOLUND_MAX_PAYLOAD) {
+            payload.resize(req.length);
+            if (req.length == 0 || readAll(client, &payload[0], req.length)) {
+                auto status = VOLUND_STATUS_OK;
+                auto reply  = handler(volund_op(req.op), payload, status);
+
+                volund_msg_header res = {req.op, uint8_t(status), 0, uint32_t(reply.size())};
+                if (writeAll(client, &res, sizeof(res)))
+                    writeAll(client, reply.data(), reply.size());
+            }
+        }
+        close(client);
+    }
+}
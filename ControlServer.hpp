@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "EventLoop.hpp"
+#include "Protocol.h"
+
+// Listens on the control socket (see Protocol.h) and answers each request through `handler`,
+// on the EventLoop's thread.
+class ControlServer {
+  public:
+    // Returns the reply payload; set status to VOLUND_STATUS_ERROR to fail the request
+    using Handler = std::function<std::string(volund_op op, const std::string& payload, volund_status& status)>;
+
+    ControlServer(EventLoop& loop, Handler handler);
+    ~ControlServer();
+
+    bool listening() const { return listenFd >= 0; }
+
+  private:
+    void accept();
+
+    EventLoop&  loop;
+    Handler     handler;
+    std::string path;
+    int         listenFd = -1;
+};
@@ -0,0 +1,95 @@
+#include "EventLoop.hpp"
+
+#include <cerrno>
+#include <cstdint>
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+
+static void drain(int fd) {
+    uint64_t val;
+    while (read(fd, &val, sizeof(val)) > 0) {}
+}
+
+static void poke(int fd) {
+    uint64_t one = 1;
+    (void)!write(fd, &one, sizeof(one));
+}
+
+EventLoop::EventLoop() : epollFd{epoll_create1(EPOLL_CLOEXEC)}, wakeFd{eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)} {
+    watch(wakeFd, [this] { drain(wakeFd); });
+}
+
+EventLoop::~EventLoop() {
+    close(wakeFd);
+    close(epollFd);
+}
+
+void EventLoop::watch(int fd, std::function<void()> onReadable) {
+    epoll_event ev = {};
+    ev.events      = EPOLLIN;
+    ev.data.fd     = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+    handlers[fd] = std::move(onReadable);
+}
+
+void EventLoop::unwatch(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    handlers.erase(fd);
+}
+
+void EventLoop::wake() { poke(wakeFd); }
+
+int EventLoop::runOnce(int timeoutMs) {
+    epoll_event evs[16];
+    int         n = epoll_wait(epollFd, evs, 16, timeoutMs);
+
+    for (int i = 0; i < n; i++) {
+        auto handler = handlers.find(evs[i].data.fd);
+        if (handler != handlers.end())
+            handler->second();
+    }
+    return n < 0 ? 0 : n;
+}
+
+SdlWakeBridge::SdlWakeBridge(EventLoop& loop, unsigned type)
+    : loop{loop}, type{type}, stopFd{eventfd(0, EFD_CLOEXEC)}, rearmFd{eventfd(0, EFD_CLOEXEC)} {
+    thread = std::thread(&SdlWakeBridge::run, this);
+}
+
+SdlWakeBridge::~SdlWakeBridge() {
+    poke(stopFd);
+    thread.join();
+    close(stopFd);
+    close(rearmFd);
+}
+
+void SdlWakeBridge::rearm() { poke(rearmFd); }
+
+void SdlWakeBridge::run() {
+    while (true) {
+        pollfd fds[] = {{stopFd, POLLIN, 0}, {loop.fd(), POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0 && errno != EINTR)
+            return;
+        if (fds[0].revents)
+            return;
+        if (!fds[1].revents)
+            continue;
+
+        SDL_Event ev = {};
+        ev.type      = type;
+        SDL_PushEvent(&ev);
+
+        // The loop stays readable until the main thread dispatches it, so don't spin on it until then
+        pollfd wait[] = {{stopFd, POLLIN, 0}, {rearmFd, POLLIN, 0}};
+        while (poll(wait, 2, -1) < 0 && errno == EINTR) {}
+        if (wait[0].revents)
+            return;
+        uint64_t val;
+        (void)!read(rearmFd, &val, sizeof(val));
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <functional>
+#include <thread>
+#include <unordered_map>
+
+// Single epoll set for everything the daemon waits on while hidden: signals, watches,
+// and an eventfd other threads can poke through wake().
+class EventLoop {
+  public:
+    EventLoop();
+    ~EventLoop();
+
+    void watch(int fd, std::function<void()> onReadable);
+    void unwatch(int fd);
+
+    // Thread-safe. Makes a blocked runOnce() return.
+    void wake();
+
+    // Dispatches whatever is ready, waiting up to timeoutMs (-1 = forever) for something to be
+    int runOnce(int timeoutMs);
+
+    // Readable whenever runOnce(0) would dispatch something
+    int fd() const { return epollFd; }
+
+  private:
+    int                                          epollFd, wakeFd;
+    std::unordered_map<int, std::function<void()>> handlers;
+};
+
+// SDL can only block on its own event queue. While one of these exists, a helper thread waits on
+// the loop for it and pushes an SDL event of `type` when it becomes ready; the receiver calls
+// loop.runOnce(0) and then rearm().
+class SdlWakeBridge {
+  public:
+    SdlWakeBridge(EventLoop& loop, unsigned type);
+    ~SdlWakeBridge();
+
+    void rearm();
+
+  private:
+    void run();
+
+    EventLoop&  loop;
+    unsigned    type;
+    int         stopFd, rearmFd;
+    std::thread thread;
+};
@@ -0,0 +1,143 @@
+#include "FileLoader.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#ifdef VOLUND_HAVE_URING
+#include <fcntl.h>
+#include <liburing.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static void loadFilesStream(const std::vector<std::string>& paths, std::vector<std::string>& out) {
+    out.assign(paths.size(), {});
+    for (size_t i = 0; i < paths.size(); i++) {
+        auto file = std::ifstream(paths[i]);
+        out[i].assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+}
+
+#ifdef VOLUND_HAVE_URING
+// Files in flight per batch. Each file costs 2 SQEs in the open stage, so the ring is twice this.
+static constexpr unsigned queueDepth = 64;
+
+static bool uringSupportsOps(io_uring& ring) {
+    auto probe = io_uring_get_probe_ring(&ring);
+    if (!probe)
+        return false;
+
+    bool ok = true;
+    for (int op : {IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_CLOSE})
+        ok = ok && io_uring_opcode_supported(probe, op);
+
+    io_uring_free_probe(probe);
+    return ok;
+}
+
+// Submits everything queued and reaps exactly `count` completions into res[user_data]
+static void submitAndReap(io_uring& ring, unsigned count, int* res) {
+    io_uring_submit_and_wait(&ring, count);
+    for (unsigned i = 0; i < count; i++) {
+        io_uring_cqe* cqe;
+        if (io_uring_wait_cqe(&ring, &cqe) < 0)
+            break;
+        res[cqe->user_data] = cqe->res;
+        io_uring_cqe_seen(&ring, cqe);
+    }
+}
+
+// Three stages per batch: openat+statx, read, close. That's 3 io_uring_enter calls for
+// up to queueDepth files instead of open/read/close syscalls per file.
+static bool loadFilesUring(const std::vector<std::string>& paths, std::vector<std::string>& out) {
+    io_uring ring;
+    if (io_uring_queue_init(queueDepth * 2, &ring, 0) < 0)
+        return false;
+
+    if (!uringSupportsOps(ring)) {
+        io_uring_queue_exit(&ring);
+        return false;
+    }
+
+    out.assign(paths.size(), {});
+
+    struct statx stx[queueDepth];
+    int          res[queueDepth * 2];
+    int          fds[queueDepth];
+
+    for (size_t base = 0; base < paths.size(); base += queueDepth) {
+        unsigned n = std::min<size_t>(queueDepth, paths.size() - base);
+
+        for (unsigned i = 0; i < n; i++) {
+            auto sqe = io_uring_get_sqe(&ring);
+            io_uring_prep_openat(sqe, AT_FDCWD, paths[base + i].c_str(), O_RDONLY | O_CLOEXEC, 0);
+            sqe->user_data = i * 2;
+
+            sqe = io_uring_get_sqe(&ring);
+            io_uring_prep_statx(sqe, AT_FDCWD, paths[base + i].c_str(), 0, STATX_SIZE, &stx[i]);
+            sqe->user_data = i * 2 + 1;
+        }
+        submitAndReap(ring, n * 2, res);
+
+        unsigned reads = 0;
+        for (unsigned i = 0; i < n; i++) {
+            fds[i] = res[i * 2];
+            if (fds[i] < 0 || res[i * 2 + 1] < 0 || stx[i].stx_size == 0)
+                continue;
+
+            auto& data = out[base + i];
+            data.resize(stx[i].stx_size);
+
+            auto sqe = io_uring_get_sqe(&ring);
+            io_uring_prep_read(sqe, fds[i], &data[0], data.size(), 0);
+            sqe->user_data = i;
+            reads++;
+        }
+        std::fill(res, res + n, 0);
+        submitAndReap(ring, reads, res);
+
+        unsigned closes = 0;
+        for (unsigned i = 0; i < n; i++) {
+            if (fds[i] < 0)
+                continue;
+
+            // Short reads just truncate; a .desktop file that changed under us will be picked up on the next reload
+            out[base + i].resize(std::max(res[i], 0));
+
+            auto sqe = io_uring_get_sqe(&ring);
+            io_uring_prep_close(sqe, fds[i]);
+            sqe->user_data = i;
+            closes++;
+        }
+        submitAndReap(ring, closes, res);
+    }
+
+    io_uring_queue_exit(&ring);
+    return true;
+}
+#endif
+
+bool uringAvailable() {
+#ifdef VOLUND_HAVE_URING
+    io_uring ring;
+    if (io_uring_queue_init(1, &ring, 0) < 0)
+        return false;
+    bool ok = uringSupportsOps(ring);
+    io_uring_queue_exit(&ring);
+    return ok;
+#else
+    return false;
+#endif
+}
+
+LoadMethod loadFiles(const std::vector<std::string>& paths, std::vector<std::string>& out, LoadMethod method) {
+#ifdef VOLUND_HAVE_URING
+    if (method != LoadMethod::Stream && loadFilesUring(paths, out))
+        return LoadMethod::Uring;
+#else
+    (void)method;
+#endif
+    loadFilesStream(paths, out);
+    return LoadMethod::Stream;
+}
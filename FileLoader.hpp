@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// How AppDB pulls the raw bytes of .desktop files off disk.
+// Auto uses io_uring when volund was built with it and the kernel allows it,
+// and quietly falls back to plain std::ifstream reads otherwise.
+enum class LoadMethod { Auto, Stream, Uring };
+
+// Reads every file in paths into out (same order). Unreadable files come back empty.
+// Returns the method that was actually used.
+LoadMethod loadFiles(const std::vector<std::string>& paths, std::vector<std::string>& out, LoadMethod method = LoadMethod::Auto);
+
+bool uringAvailable();
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit FNV-1a, for cache keys
+static constexpr uint64_t fnvBasis = 0xcbf29ce484222325ull;
+
+inline uint64_t fnv1a(uint64_t hash, const void* data, size_t len) {
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; i++) hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    return hash;
+}
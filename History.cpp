@@ -0,0 +1,79 @@
+#include "History.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+
+#include "BinIO.hpp"
+#include "Xdg.hpp"
+
+static constexpr uint32_t historyMagic   = 0x54534856; // "VHST"
+static constexpr uint32_t historyVersion = 1;
+
+History::History() : file{xdg::dataHome() + "/volund/history"} {
+    auto in = std::ifstream(file, std::ios::binary);
+
+    uint32_t magic, version, count;
+    if (!binio::read(in, magic) || !binio::read(in, version) || magic != historyMagic || version != historyVersion ||
+        !binio::read(in, count))
+        return;
+
+    for (uint32_t i = 0; i < count; i++) {
+        std::string name;
+        Entry       entry;
+        if (!binio::readStr(in, name) || !binio::read(in, entry.count) || !binio::read(in, entry.lastUsed))
+            return;
+        entries[name] = entry;
+    }
+}
+
+void History::record(const std::string& name) {
+    auto& entry = entries[name];
+    entry.count++;
+    entry.lastUsed = time(nullptr);
+    recorded++;
+    save();
+}
+
+std::vector<std::string> History::top(size_t n) const {
+    auto now = time(nullptr);
+
+    // Same buckets as Firefox's frecency, roughly
+    auto score = [&](const Entry& entry) {
+        auto   days   = (now - entry.lastUsed) / 86400;
+        double weight = days < 4 ? 1.0 : days < 14 ? 0.7 : days < 31 ? 0.5 : days < 90 ? 0.3 : 0.1;
+        return entry.count * weight;
+    };
+
+    std::vector<std::pair<double, const std::string*>> ranked;
+    for (auto& [name, entry] : entries) ranked.push_back({score(entry), &name});
+
+    n = std::min(n, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + n, ranked.end(), [](auto& a, auto& b) { return a.first > b.first; });
+
+    std::vector<std::string> names;
+    for (size_t i = 0; i < n; i++) names.push_back(*ranked[i].second);
+    return names;
+}
+
+void History::save() const {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(file).parent_path(), ec);
+
+    auto tmp = file + ".tmp";
+    {
+        auto out = std::ofstream(tmp, std::ios::binary | std::ios::trunc);
+        binio::write(out, historyMagic);
+        binio::write(out, historyVersion);
+        binio::write<uint32_t>(out, entries.size());
+        for (auto& [name, entry] : entries) {
+            binio::writeStr(out, name);
+            binio::write(out, entry.count);
+            binio::write(out, entry.lastUsed);
+        }
+        if (!out)
+            return;
+    }
+    std::filesystem::rename(tmp, file, ec);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// How often and how recently each app was launched, kept in $XDG_DATA_HOME/volund/history.
+class History {
+  public:
+    History();
+
+    // Saves straight away; launches are rare enough that batching isn't worth losing any
+    void record(const std::string& name);
+
+    // Names by frecency: launch count weighted down the longer ago the last launch was
+    std::vector<std::string> top(size_t n) const;
+
+    // record() calls since startup, to check launches really end up here
+    unsigned recorded = 0;
+
+  private:
+    struct Entry {
+        uint32_t count    = 0;
+        int64_t  lastUsed = 0; // Unix time, seconds
+    };
+
+    void save() const;
+
+    std::string                            file;
+    std::unordered_map<std::string, Entry> entries;
+};
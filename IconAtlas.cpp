@@ -0,0 +1,184 @@
+#include "IconAtlas.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include <sys/stat.h>
+
+#include <SDL2/SDL.h>
+#ifdef VOLUND_HAVE_SDL_IMAGE
+#include <SDL2/SDL_image.h>
+#endif
+
+#include "BinIO.hpp"
+#include "Hash.hpp"
+#include "Xdg.hpp"
+
+static constexpr uint32_t atlasMagic   = 0x4c544156; // "VATL"
+static constexpr uint32_t atlasVersion = 1;
+static constexpr unsigned atlasWidth   = 1024;
+
+// Order-independent so the unordered IconPaths iteration order doesn't matter
+static uint64_t atlasKey(const IconPaths& paths, unsigned cellSize) {
+    uint64_t key = fnv1a(fnvBasis, &cellSize, sizeof(cellSize));
+    for (auto& [name, path] : paths) {
+        struct stat st;
+        int64_t     mtime = stat(path.c_str(), &st) == 0 ? int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec : -1;
+
+        uint64_t h = fnv1a(fnvBasis, name.data(), name.size());
+        h          = fnv1a(h, path.data(), path.size());
+        h          = fnv1a(h, &mtime, sizeof(mtime));
+        key += h;
+    }
+    return key;
+}
+
+bool IconAtlasImage::load(const std::string& file, uint64_t wantKey) {
+    auto in = std::ifstream(file, std::ios::binary);
+
+    uint32_t magic, version, count;
+    if (!binio::read(in, magic) || !binio::read(in, version) || magic != atlasMagic || version != atlasVersion)
+        return false;
+    if (!binio::read(in, key) || key != wantKey)
+        return false;
+    if (!binio::read(in, cellSize) || !binio::read(in, width) || !binio::read(in, height) || !binio::read(in, count))
+        return false;
+
+    cells.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        std::string name;
+        Cell        cell;
+        if (!binio::readStr(in, name) || !binio::read(in, cell))
+            return false;
+        cells[name] = cell;
+    }
+
+    pixels.resize(size_t(width) * height * 4);
+    return bool(in.read(reinterpret_cast<char*>(pixels.data()), pixels.size()));
+}
+
+void IconAtlasImage::save(const std::string& file) const {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(file).parent_path(), ec);
+
+    auto tmp = file + ".tmp";
+    {
+        auto out = std::ofstream(tmp, std::ios::binary | std::ios::trunc);
+        binio::write(out, atlasMagic);
+        binio::write(out, atlasVersion);
+        binio::write(out, key);
+        binio::write(out, cellSize);
+        binio::write(out, width);
+        binio::write(out, height);
+
+        binio::write<uint32_t>(out, cells.size());
+        for (auto& [name, cell] : cells) {
+            binio::writeStr(out, name);
+            binio::write(out, cell);
+        }
+        out.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+        if (!out)
+            return;
+    }
+    std::filesystem::rename(tmp, file, ec);
+}
+
+IconAtlas::IconAtlas(unsigned cellSize) : cellSize{cellSize} { worker = std::thread(&IconAtlas::work, this); }
+
+IconAtlas::~IconAtlas() {
+    {
+        std::lock_guard lock{mutex};
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void IconAtlas::request(std::shared_ptr<const IconPaths> paths) {
+    {
+        std::lock_guard lock{mutex};
+        pending = std::move(paths);
+    }
+    wake.notify_one();
+}
+
+void IconAtlas::work() {
+    auto file = xdg::cacheHome() + "/volund/icons.atlas";
+
+    while (true) {
+        std::shared_ptr<const IconPaths> paths;
+        {
+            std::unique_lock lock{mutex};
+            wake.wait(lock, [&] { return pending || stopping; });
+            if (stopping)
+                return;
+            paths = std::move(pending);
+        }
+
+        auto key     = atlasKey(*paths, cellSize);
+        auto current = latest();
+        if (current && current->key == key)
+            continue;
+
+        auto img = std::make_shared<IconAtlasImage>();
+        if (!img->load(file, key)) {
+            img->key = key;
+            if (decode(*paths, *img))
+                img->save(file);
+        }
+        std::atomic_store(&published, std::shared_ptr<const IconAtlasImage>(std::move(img)));
+        if (onPublished)
+            onPublished();
+    }
+}
+
+bool IconAtlas::decode(const IconPaths& paths, IconAtlasImage& img) {
+    unsigned cols = atlasWidth / cellSize;
+    unsigned rows = (paths.size() + cols - 1) / cols;
+
+    img.cellSize = cellSize;
+    img.width    = atlasWidth;
+    img.height   = std::max(rows, 1u) * cellSize;
+    img.pixels.assign(size_t(img.width) * img.height * 4, 0);
+    img.cells.clear();
+
+#ifdef VOLUND_HAVE_SDL_IMAGE
+    auto cell = SDL_CreateRGBSurfaceWithFormat(0, cellSize, cellSize, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!cell)
+        return false;
+
+    unsigned next = 0;
+    for (auto& [name, path] : paths) {
+        auto loaded = IMG_Load(path.c_str());
+        if (!loaded) {
+            std::cerr << "Couldn't decode icon " << path << ": " << SDL_GetError() << '\n';
+            continue;
+        }
+        auto rgba = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+        SDL_FreeSurface(loaded);
+        if (!rgba)
+            continue;
+
+        // Straight copy of the alpha channel rather than blending onto the (transparent) cell
+        SDL_SetSurfaceBlendMode(rgba, SDL_BLENDMODE_NONE);
+        SDL_BlitScaled(rgba, nullptr, cell, nullptr);
+        SDL_FreeSurface(rgba);
+
+        IconAtlasImage::Cell pos = {uint16_t(next % cols * cellSize), uint16_t(next / cols * cellSize)};
+        for (unsigned y = 0; y < cellSize; y++)
+            memcpy(&img.pixels[((pos.y + y) * img.width + pos.x) * 4], static_cast<uint8_t*>(cell->pixels) + y * cell->pitch, cellSize * 4);
+
+        img.cells[name] = pos;
+        next++;
+    }
+    SDL_FreeSurface(cell);
+    return true;
+#else
+    // Nothing to decode with; don't cache an empty atlas that a later build with SDL2_image would trust
+    (void)paths;
+    return false;
+#endif
+}
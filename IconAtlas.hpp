@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "IconResolver.hpp"
+
+// Every resolved icon decoded at one fixed size and packed into a single RGBA image,
+// ready to be uploaded as one texture.
+struct IconAtlasImage {
+    struct Cell {
+        uint16_t x, y;
+    };
+
+    uint64_t                              key = 0; // Hash of every (path, mtime) that went into it
+    unsigned                              cellSize = 0, width = 0, height = 0;
+    std::vector<uint8_t>                  pixels;
+    std::unordered_map<std::string, Cell> cells; // Icon= name -> top left of its cell
+
+    bool load(const std::string& file, uint64_t key);
+    void save(const std::string& file) const;
+};
+
+// Decodes icons on a worker thread and persists the result, so reopening the picker with the
+// same set of icons costs one file read instead of a decode per icon.
+class IconAtlas {
+  public:
+    IconAtlas(unsigned cellSize = 24);
+    ~IconAtlas();
+
+    void request(std::shared_ptr<const IconPaths> paths);
+
+    std::shared_ptr<const IconAtlasImage> latest() const { return std::atomic_load(&published); }
+
+    // Called from the worker thread after a new atlas is published
+    std::function<void()> onPublished;
+
+  private:
+    void work();
+    bool decode(const IconPaths& paths, IconAtlasImage& img);
+
+    unsigned cellSize;
+
+    std::shared_ptr<const IconAtlasImage> published;
+
+    std::mutex                       mutex;
+    std::condition_variable          wake;
+    std::shared_ptr<const IconPaths> pending;
+    bool                             stopping = false;
+    std::thread                      worker;
+};
@@ -0,0 +1,407 @@
+#include "IconResolver.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+#include <sys/stat.h>
+
+#include "BinIO.hpp"
+#include "Xdg.hpp"
+#include "yaip.hpp"
+
+namespace fs = std::filesystem;
+
+static int64_t mtimeOf(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return -1;
+    return int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+static std::vector<std::string> splitList(const std::string& str) {
+    std::vector<std::string> parts;
+    std::stringstream        ss{str};
+    for (std::string part; std::getline(ss, part, ',');) {
+        INIFile::trim(part);
+        if (!part.empty())
+            parts.push_back(part);
+    }
+    return parts;
+}
+
+static std::vector<std::string> iconBases() {
+    std::vector<std::string> bases = {xdg::home() + "/.icons", xdg::dataHome() + "/icons"};
+    for (auto& dir : xdg::dataDirs()) bases.push_back(dir + "/icons");
+    return bases;
+}
+
+void IconIndex::build(const std::string& theme) {
+    icons.clear();
+    watched.clear();
+    rank = 0;
+
+    std::vector<std::string> seen;
+    addTheme(theme, seen);
+    addTheme("hicolor", seen);
+
+    // Unthemed fallback. Size unknown, so lookup() only picks these as a last resort.
+    rank++;
+    for (auto& dir : xdg::dataDirs()) {
+        auto pixmaps = dir + "/pixmaps";
+        if (!fs::is_directory(pixmaps))
+            continue;
+        watch(pixmaps);
+        addThemeDir(pixmaps, 0, false);
+    }
+}
+
+void IconIndex::watch(const std::string& dir) { watched.push_back({dir, mtimeOf(dir)}); }
+
+bool IconIndex::stale() const {
+    for (auto& [dir, mtime] : watched)
+        if (mtimeOf(dir) != mtime)
+            return true;
+    return false;
+}
+
+void IconIndex::addTheme(const std::string& theme, std::vector<std::string>& seen) {
+    if (std::find(seen.begin(), seen.end(), theme) != seen.end())
+        return;
+    seen.push_back(theme);
+    rank++;
+
+    std::vector<std::string> themeDirs;
+    INIFile                  ini;
+    bool                     haveIndex = false;
+    for (auto& base : iconBases()) {
+        auto themeDir = base + "/" + theme;
+        if (!fs::is_directory(themeDir))
+            continue;
+        themeDirs.push_back(themeDir);
+
+        if (!haveIndex) {
+            auto file = std::ifstream(themeDir + "/index.theme");
+            if (file) {
+                ini.parse(file);
+                haveIndex = true;
+            }
+        }
+    }
+    if (!haveIndex)
+        return;
+
+    // subdir -> (nominal size, scalable)
+    std::unordered_map<std::string, std::pair<uint16_t, bool>> dirs;
+    for (auto& subdir : splitList(ini["Icon Theme"]["Directories"])) {
+        auto& section = ini[subdir];
+        // HiDPI variants duplicate the normal ones at a bigger pixel size; not worth indexing twice
+        if (!section["Scale"].empty() && section["Scale"] != "1")
+            continue;
+
+        auto size = section["Size"].empty() ? 0 : std::atoi(section["Size"].c_str());
+        dirs[subdir] = {uint16_t(size), section["Type"] == "Scalable"};
+    }
+
+    for (auto& themeDir : themeDirs) {
+        watch(themeDir);
+        if (addIconCache(themeDir, dirs))
+            continue;
+
+        for (auto& [subdir, info] : dirs) {
+            auto dir = themeDir + "/" + subdir;
+            if (!fs::is_directory(dir))
+                continue;
+            watch(dir);
+            addThemeDir(dir, info.first, info.second);
+        }
+    }
+
+    for (auto& parent : splitList(ini["Icon Theme"]["Inherits"])) addTheme(parent, seen);
+}
+
+void IconIndex::addThemeDir(const std::string& dir, uint16_t size, bool scalable) {
+    std::error_code ec;
+    for (auto& f : fs::directory_iterator(dir, ec)) {
+        auto ext = f.path().extension();
+        if (ext != ".png" && ext != ".svg" && ext != ".xpm")
+            continue;
+        addImage(f.path().stem(), size, scalable, f.path());
+    }
+}
+
+void IconIndex::addImage(const std::string& name, uint16_t size, bool scalable, std::string path) {
+    auto& images = icons[name];
+    for (auto& img : images)
+        if (img.size == size && img.scalable == scalable)
+            return; // An earlier theme in the chain already provides this one
+
+    images.push_back({size, scalable, rank, std::move(path)});
+}
+
+// GTK's icon-theme.cache (written by gtk-update-icon-cache): a big-endian hash table of
+// icon name -> list of (directory index, flags). Only trusted if it is at least as new as the theme dir.
+bool IconIndex::addIconCache(const std::string& themeDir, const std::unordered_map<std::string, std::pair<uint16_t, bool>>& dirs) {
+    auto cachePath = themeDir + "/icon-theme.cache";
+    auto cacheTime = mtimeOf(cachePath);
+    if (cacheTime < 0 || cacheTime < mtimeOf(themeDir))
+        return false;
+
+    auto              file = std::ifstream(cachePath, std::ios::binary);
+    std::vector<char> buf{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    auto              data = reinterpret_cast<const unsigned char*>(buf.data());
+
+    bool ok   = true;
+    auto be16 = [&](uint32_t off) -> uint32_t {
+        if (off + 2 > buf.size())
+            return ok = false;
+        return data[off] << 8 | data[off + 1];
+    };
+    auto be32 = [&](uint32_t off) -> uint32_t {
+        if (off + 4 > buf.size())
+            return ok = false;
+        return uint32_t(data[off]) << 24 | data[off + 1] << 16 | data[off + 2] << 8 | data[off + 3];
+    };
+    auto str = [&](uint32_t off) -> std::string {
+        if (off >= buf.size())
+            return ok = false, "";
+        return std::string(buf.data() + off, strnlen(buf.data() + off, buf.size() - off));
+    };
+
+    if (be16(0) != 1)
+        return false;
+
+    uint32_t                 hashOff = be32(4), dirListOff = be32(8);
+    std::vector<std::string> dirNames(std::min<size_t>(be32(dirListOff), buf.size() / 4));
+    for (uint32_t i = 0; ok && i < dirNames.size(); i++) dirNames[i] = str(be32(dirListOff + 4 + i * 4));
+
+    // A corrupt chain could loop forever; no valid file has more icons than 12-byte records fit
+    size_t   budget  = buf.size() / 12;
+    uint32_t buckets = be32(hashOff);
+    for (uint32_t b = 0; ok && b < buckets; b++) {
+        for (uint32_t icon = be32(hashOff + 4 + b * 4); ok && icon != 0xFFFFFFFF; icon = be32(icon)) {
+            if (budget-- == 0)
+                return false;
+
+            auto     name    = str(be32(icon + 4));
+            uint32_t listOff = be32(icon + 8);
+            uint32_t images  = be32(listOff);
+
+            for (uint32_t i = 0; ok && i < images; i++) {
+                uint32_t dirIdx = be16(listOff + 4 + i * 8), flags = be16(listOff + 6 + i * 8);
+                if (dirIdx >= dirNames.size())
+                    continue;
+
+                auto dir = dirs.find(dirNames[dirIdx]);
+                if (dir == dirs.end())
+                    continue;
+
+                const char* ext = flags & 4 ? ".png" : flags & 2 ? ".svg" : flags & 1 ? ".xpm" : nullptr;
+                if (ext)
+                    addImage(name, dir->second.first, dir->second.second, themeDir + "/" + dir->first + "/" + name + ext);
+            }
+        }
+    }
+
+    if (ok)
+        watch(cachePath);
+    return ok;
+}
+
+const std::string* IconIndex::lookup(const std::string& name, unsigned size) const {
+    auto it = icons.find(name);
+    if (it == icons.end()) {
+        // Plenty of entries say Icon=foo.png even though the spec says not to. Only a real image
+        // extension though, since names like org.gnome.Foo are full of dots.
+        for (auto ext : {".png", ".svg", ".xpm"}) {
+            size_t len = strlen(ext);
+            if (name.size() > len && name.compare(name.size() - len, len, ext) == 0) {
+                it = icons.find(name.substr(0, name.size() - len));
+                break;
+            }
+        }
+        if (it == icons.end())
+            return nullptr;
+    }
+
+    const std::string* best      = nullptr;
+    unsigned           bestScore = ~0u;
+    for (auto& img : it->second) {
+        unsigned score = img.size == 0 ? 100000
+                         : img.scalable ? 1
+                         : img.size == size ? 0
+                         : img.size > size ? 2 + (img.size - size)
+                                           : 1000 + (size - img.size);
+        score += img.rank * 1000000u;
+        if (score < bestScore) {
+            best      = &img.path;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+static constexpr uint32_t indexMagic = 0x58444956; // "VIDX"
+static constexpr uint32_t indexVersion = 1;
+
+void IconIndex::save(const std::string& file) const {
+    std::error_code ec;
+    fs::create_directories(fs::path(file).parent_path(), ec);
+
+    auto tmp = file + ".tmp";
+    {
+        auto out = std::ofstream(tmp, std::ios::binary | std::ios::trunc);
+        binio::write(out, indexMagic);
+        binio::write(out, indexVersion);
+
+        binio::write<uint32_t>(out, watched.size());
+        for (auto& [dir, mtime] : watched) {
+            binio::writeStr(out, dir);
+            binio::write(out, mtime);
+        }
+
+        binio::write<uint32_t>(out, icons.size());
+        for (auto& [name, images] : icons) {
+            binio::writeStr(out, name);
+            binio::write<uint32_t>(out, images.size());
+            for (auto& img : images) {
+                binio::write(out, img.size);
+                binio::write<uint8_t>(out, img.scalable);
+                binio::write(out, img.rank);
+                binio::writeStr(out, img.path);
+            }
+        }
+        if (!out)
+            return;
+    }
+    fs::rename(tmp, file, ec);
+}
+
+bool IconIndex::load(const std::string& file) {
+    auto in = std::ifstream(file, std::ios::binary);
+
+    uint32_t magic, version, count;
+    if (!binio::read(in, magic) || !binio::read(in, version) || magic != indexMagic || version != indexVersion)
+        return false;
+
+    icons.clear();
+    watched.clear();
+
+    if (!binio::read(in, count))
+        return false;
+    watched.resize(count);
+    for (auto& [dir, mtime] : watched)
+        if (!binio::readStr(in, dir) || !binio::read(in, mtime))
+            return false;
+
+    if (!binio::read(in, count))
+        return false;
+    icons.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        std::string name;
+        uint32_t    images;
+        if (!binio::readStr(in, name) || !binio::read(in, images))
+            return false;
+
+        auto& list = icons[name];
+        list.resize(images);
+        for (auto& img : list) {
+            uint8_t scalable;
+            if (!binio::read(in, img.size) || !binio::read(in, scalable) || !binio::read(in, img.rank) || !binio::readStr(in, img.path))
+                return false;
+            img.scalable = scalable;
+        }
+    }
+    return true;
+}
+
+std::string IconResolver::configuredTheme() {
+    auto theme = xdg::env("VOLUND_ICON_THEME", "");
+    if (!theme.empty())
+        return theme;
+
+    INIFile ini;
+    auto    file = std::ifstream(xdg::configHome() + "/gtk-3.0/settings.ini");
+    ini.parse(file);
+    theme = ini["Settings"]["gtk-icon-theme-name"];
+    return theme.empty() ? "hicolor" : theme;
+}
+
+IconResolver::IconResolver(unsigned size) : size{size}, theme{configuredTheme()} {
+    worker = std::thread(&IconResolver::work, this);
+}
+
+IconResolver::~IconResolver() {
+    {
+        std::lock_guard lock{mutex};
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void IconResolver::request(std::vector<std::string> names) {
+    {
+        std::lock_guard lock{mutex};
+        pending    = std::move(names);
+        hasPending = true;
+    }
+    wake.notify_one();
+}
+
+void IconResolver::refresh() {
+    {
+        std::lock_guard lock{mutex};
+        hasPending = true;
+    }
+    wake.notify_one();
+}
+
+void IconResolver::work() {
+    IconIndex index;
+    bool      loaded    = false;
+    auto      indexFile = xdg::cacheHome() + "/volund/icons-" + theme + ".idx";
+
+    while (true) {
+        std::vector<std::string> names;
+        {
+            std::unique_lock lock{mutex};
+            wake.wait(lock, [&] { return hasPending || stopping; });
+            if (stopping)
+                return;
+            names      = pending;
+            hasPending = false;
+        }
+
+        if (!loaded)
+            loaded = index.load(indexFile) && !index.stale();
+        else
+            loaded = !index.stale();
+
+        if (!loaded) {
+            std::cerr << "Rebuilding icon index for theme '" << theme << "'...\n";
+            index.build(theme);
+            index.save(indexFile);
+            loaded = true;
+        }
+
+        auto paths = std::make_shared<IconPaths>();
+        for (auto& name : names) {
+            if (name.empty())
+                continue;
+            if (name[0] == '/') {
+                (*paths)[name] = name;
+            } else if (auto path = index.lookup(name, size)) {
+                (*paths)[name] = *path;
+            }
+        }
+        std::shared_ptr<const IconPaths> result = std::move(paths);
+        std::atomic_store(&published, result);
+        if (onResolved)
+            onResolved(std::move(result));
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Icon name -> absolute path of the file to draw
+using IconPaths = std::unordered_map<std::string, std::string>;
+
+// Every icon a theme (plus its Inherits= chain and hicolor) provides, with one path per size.
+struct IconIndex {
+    struct Image {
+        uint16_t    size;
+        bool        scalable;
+        uint16_t    rank; // Position of the providing theme in the Inherits chain
+        std::string path;
+    };
+
+    std::unordered_map<std::string, std::vector<Image>> icons;
+
+    // Directories whose mtime decides whether the index is stale
+    std::vector<std::pair<std::string, int64_t>> watched;
+
+    void build(const std::string& theme);
+    bool stale() const;
+
+    bool load(const std::string& file);
+    void save(const std::string& file) const;
+
+    // Closest match to size within the most specific theme that has the icon at all,
+    // preferring an exact size, then scalable images, then the next size up
+    const std::string* lookup(const std::string& name, unsigned size) const;
+
+  private:
+    void addTheme(const std::string& theme, std::vector<std::string>& seen);
+    void addThemeDir(const std::string& dir, uint16_t size, bool scalable);
+    bool addIconCache(const std::string& themeDir, const std::unordered_map<std::string, std::pair<uint16_t, bool>>& dirs);
+    void addImage(const std::string& name, uint16_t size, bool scalable, std::string path);
+    void watch(const std::string& dir);
+
+    uint16_t rank = 0;
+};
+
+// Owns the icon index and resolves Icon= names on a worker thread.
+// The UI only ever reads the latest published IconPaths; it never stats or parses anything itself.
+class IconResolver {
+  public:
+    IconResolver(unsigned size = 24);
+    ~IconResolver();
+
+    // Queue a (re)resolve of these names. Also rechecks the theme for changes.
+    void request(std::vector<std::string> names);
+    // Same names as last time; cheap unless the theme changed on disk
+    void refresh();
+
+    std::shared_ptr<const IconPaths> resolved() const { return std::atomic_load(&published); }
+
+    static std::string configuredTheme();
+
+    // Called from the worker thread every time a new set of paths is published
+    std::function<void(std::shared_ptr<const IconPaths>)> onResolved;
+
+  private:
+    void work();
+
+    unsigned    size;
+    std::string theme;
+
+    std::shared_ptr<const IconPaths> published = std::make_shared<IconPaths>();
+
+    std::mutex               mutex;
+    std::condition_variable  wake;
+    std::vector<std::string> pending;
+    bool                     hasPending = false, stopping = false;
+    std::thread              worker;
+};
@@ -0,0 +1,297 @@
+#include "Launcher.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+// Zygote requests are one seqpacket each: this header, then NUL terminated cwd, argv and env strings.
+// The reply is a ZygoteReply with the app's pid and 0, or the errno that stopped it from starting.
+struct ZygoteRequest {
+    uint32_t argc, envc;
+};
+
+struct ZygoteReply {
+    int32_t err;
+    int32_t pid;
+};
+
+static constexpr size_t zygoteMaxRequest = 256 * 1024;
+
+// A zygote that has sat on a request this long is taken to be wedged
+static constexpr auto zygoteTimeout = std::chrono::seconds(2);
+
+static bool readAll(int fd, void* buf, size_t len) {
+    auto bytes = static_cast<char*>(buf);
+    while (len) {
+        auto n = read(fd, bytes, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        bytes += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Runs a single request: fork a child that starts a new session and forks the app itself, then
+// exits right away. The app is reparented to init (or a subreaper), so the only child the zygote
+// ever has to reap is the short-lived middle one.
+// The app reports its pid, then an errno if chdir/exec fails, through a CLOEXEC pipe; EOF after
+// the pid means exec went through.
+static ZygoteReply zygoteSpawn(char* buf, size_t len) {
+    ZygoteRequest req;
+    if (len < sizeof(req))
+        return {EINVAL, -1};
+    memcpy(&req, buf, sizeof(req));
+
+    std::vector<char*> strings;
+    for (size_t pos = sizeof(req); pos < len; pos += strlen(buf + pos) + 1) strings.push_back(buf + pos);
+    if (buf[len - 1] != '\0' || strings.size() != 1 + size_t(req.argc) + req.envc || req.argc == 0)
+        return {EINVAL, -1};
+
+    char*              cwd = strings[0];
+    std::vector<char*> argv(strings.begin() + 1, strings.begin() + 1 + req.argc);
+    std::vector<char*> env(strings.begin() + 1 + req.argc, strings.end());
+    argv.push_back(nullptr);
+    env.push_back(nullptr);
+
+    int report[2];
+    if (pipe2(report, O_CLOEXEC) < 0)
+        return {errno, -1};
+
+    pid_t middle = fork();
+    if (middle == 0) {
+        close(report[0]);
+        setsid();
+        if (fork() == 0) {
+            // Ignored dispositions survive exec, so undo zygoteMain's
+            signal(SIGUSR1, SIG_DFL);
+            signal(SIGUSR2, SIG_DFL);
+            int32_t msg = getpid();
+            (void)!write(report[1], &msg, sizeof(msg));
+            if (!*cwd || chdir(cwd) == 0)
+                execvpe(argv[0], argv.data(), env.data());
+            msg = errno;
+            (void)!write(report[1], &msg, sizeof(msg));
+            _exit(127);
+        }
+        _exit(0);
+    }
+    close(report[1]);
+    if (middle < 0) {
+        int err = errno;
+        close(report[0]);
+        return {err, -1};
+    }
+    while (waitpid(middle, nullptr, 0) < 0 && errno == EINTR) {}
+
+    ZygoteReply reply = {0, -1};
+    if (!readAll(report[0], &reply.pid, sizeof(reply.pid)))
+        reply.err = EAGAIN; // The middle child couldn't fork
+    else if (!readAll(report[0], &reply.err, sizeof(reply.err)))
+        reply.err = 0;
+    close(report[0]);
+    return reply;
+}
+
+[[noreturn]] static void zygoteMain(int fd) {
+    // The hotkey is `pkill -USR1 volund`, which would match (and kill) a fork still called volund.
+    // Ignore both toggles before anything can unblock them, and go by another name.
+    signal(SIGUSR1, SIG_IGN);
+    signal(SIGUSR2, SIG_IGN);
+    prctl(PR_SET_NAME, "volund-zygote");
+
+    // Nothing else volund sets up should reach the apps
+    sigset_t none;
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, nullptr);
+
+    std::vector<char> buf(zygoteMaxRequest);
+    while (true) {
+        auto n = recv(fd, buf.data(), buf.size(), MSG_TRUNC);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) // volund went away
+            _exit(0);
+
+        auto reply = size_t(n) > buf.size() ? ZygoteReply{E2BIG, -1} : zygoteSpawn(buf.data(), n);
+        if (send(fd, &reply, sizeof(reply), MSG_NOSIGNAL) < 0)
+            _exit(0);
+    }
+}
+
+Launcher::Launcher() {
+    if (std::getenv("VOLUND_NO_ZYGOTE"))
+        return;
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0)
+        return;
+
+    zygotePid = fork();
+    if (zygotePid == 0) {
+        close(fds[0]);
+        zygoteMain(fds[1]);
+    }
+    close(fds[1]);
+    if (zygotePid < 0) {
+        std::cerr << "Couldn't start the launcher zygote: " << strerror(errno) << '\n';
+        close(fds[0]);
+        return;
+    }
+
+    // Replies are only ever read without waiting. A zygote too wedged to even take a request
+    // shouldn't hang the UI either; a send that times out never reached it, so spawning directly is safe.
+    timeval timeout = {2, 0};
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    zygoteFd = fds[0];
+}
+
+Launcher::~Launcher() {
+    // The zygote exits on EOF; SIGCHLD reaping (or init) takes care of it from there.
+    // No unwatch: we're made before the loop, so it's already gone.
+    if (zygoteFd >= 0)
+        close(zygoteFd);
+}
+
+void Launcher::watchReplies(EventLoop& eventLoop) {
+    loop = &eventLoop;
+    if (zygoteFd >= 0)
+        loop->watch(zygoteFd, [this] { collectReplies(); });
+}
+
+void Launcher::collectReplies() {
+    while (zygoteFd >= 0) {
+        ZygoteReply reply;
+        auto        n = recv(zygoteFd, &reply, sizeof(reply), MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // Whatever it still had queued may or may not start; it's reported failed rather than run twice
+            if (!pending.empty() && std::chrono::steady_clock::now() - pending.front().sent > zygoteTimeout)
+                dropZygote(ETIMEDOUT);
+            return;
+        }
+        if (n != sizeof(reply) || pending.empty()) {
+            dropZygote(ECONNRESET);
+            return;
+        }
+        record(pending.front().name, pending.front().sent, reply.err);
+        pending.pop_front();
+    }
+}
+
+void Launcher::dropZygote(int err) {
+    std::cerr << "Launcher zygote stopped answering; spawning apps directly from now on\n";
+    if (loop)
+        loop->unwatch(zygoteFd);
+    close(zygoteFd);
+    zygoteFd = -1;
+    kill(zygotePid, SIGKILL);
+
+    for (auto& req : pending) record(req.name, req.sent, err);
+    pending.clear();
+}
+
+void Launcher::record(const std::string& name, std::chrono::steady_clock::time_point start, int err) {
+    uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    stats.launches++;
+    stats.lastUs = us;
+    stats.totalUs += us;
+    stats.maxUs = std::max(stats.maxUs, us);
+
+    if (err) {
+        stats.failures++;
+        std::cerr << "Couldn't launch " << name << ": " << strerror(err) << '\n';
+    }
+}
+
+bool Launcher::launch(const App& app) {
+    if (app.argv.empty())
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+    collectReplies();
+
+    std::vector<char*> env;
+    for (auto var = environ; *var; var++)
+        if (strncmp(*var, "VOLUND_", 7) != 0)
+            env.push_back(*var);
+
+    int err = zygoteFd >= 0 ? sendZygote(app.argv, env, app.cwd) : -1;
+    if (err == 0) {
+        pending.push_back({app.argv[0], start});
+        return true;
+    }
+    if (err < 0) {
+        std::vector<char*> argv;
+        for (auto& arg : app.argv) argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+        env.push_back(nullptr);
+        err = spawnDirect(argv.data(), env.data(), app.cwd);
+    }
+
+    record(app.argv[0], start, err);
+    return err == 0;
+}
+
+// Returns 0 once the request is with the zygote, an errno if it can't be sent at all, or -1 if the
+// zygote is gone (or too wedged to take it) and the app was never handed over
+int Launcher::sendZygote(const std::vector<std::string>& argv, const std::vector<char*>& env, const std::string& cwd) {
+    ZygoteRequest     req = {uint32_t(argv.size()), uint32_t(env.size())};
+    std::vector<char> msg(reinterpret_cast<char*>(&req), reinterpret_cast<char*>(&req) + sizeof(req));
+    msg.insert(msg.end(), cwd.c_str(), cwd.c_str() + cwd.size() + 1);
+    for (auto& arg : argv) msg.insert(msg.end(), arg.c_str(), arg.c_str() + arg.size() + 1);
+    for (auto var : env) msg.insert(msg.end(), var, var + strlen(var) + 1);
+    if (msg.size() > zygoteMaxRequest)
+        return E2BIG;
+
+    // Seqpacket sends are all or nothing, so a failed one never reached the zygote
+    if (send(zygoteFd, msg.data(), msg.size(), MSG_NOSIGNAL) == ssize_t(msg.size()))
+        return 0;
+    dropZygote(ECONNRESET);
+    return -1;
+}
+
+int Launcher::spawnDirect(char* const* argv, char* const* env, const std::string& cwd) {
+    // We block a few signals to read them through a signalfd; none of that should leak into apps
+    sigset_t empty, defaults;
+    sigemptyset(&empty);
+    sigemptyset(&defaults);
+    for (int sig : {SIGUSR1, SIGUSR2, SIGCHLD, SIGPIPE}) sigaddset(&defaults, sig);
+
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+    posix_spawnattr_setsigmask(&attr, &empty);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (!cwd.empty())
+        posix_spawn_file_actions_addchdir_np(&actions, cwd.c_str());
+
+    // glibc's posix_spawn is a CLONE_VFORK under the hood: we're only held up until the exec
+    pid_t pid;
+    int   err = posix_spawnp(&pid, argv[0], &actions, &attr, argv, env);
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    return err;
+}
+
+void Launcher::reapChildren() {
+    while (waitpid(-1, nullptr, WNOHANG) > 0) {}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+#include <sys/types.h>
+
+#include "AppDB.hpp"
+#include "EventLoop.hpp"
+
+// Starts apps straight from their pre-split argv: no shell, and never a fork of our whole address
+// space. Launches go through a small zygote process forked before SDL and GL exist, which
+// double-forks and execs each app so it ends up in its own session, reparented away from us.
+// Without the zygote (VOLUND_NO_ZYGOTE, or it died) apps are posix_spawnp'd directly.
+// Either way apps get default signal handling and our environment minus volund's own settings.
+class Launcher {
+  public:
+    // Forks the zygote, so construct this before SDL_Init or any other thread
+    Launcher();
+    ~Launcher();
+
+    // True once the app is handed to the zygote or spawned. The zygote's verdict on the exec comes
+    // back later, through the loop given to watchReplies (or the next launch()), so a slow cold exec
+    // never holds up the caller; a failure then is only reported and counted.
+    bool launch(const App& app);
+
+    // Call once the loop exists; the zygote's replies are read from it from then on
+    void watchReplies(EventLoop& loop);
+    void collectReplies();
+
+    // Our directly spawned children (and the zygote) are our children; call on SIGCHLD so they
+    // don't linger as zombies
+    static void reapChildren();
+
+    // Time from launch() to the app's exec having happened (or failed), as far as we know: zygote
+    // launches are counted when their reply is collected
+    struct Stats {
+        unsigned launches = 0, failures = 0;
+        uint64_t lastUs = 0, totalUs = 0, maxUs = 0;
+    } stats;
+
+    bool usingZygote() const { return zygoteFd >= 0; }
+
+  private:
+    int spawnDirect(char* const* argv, char* const* env, const std::string& cwd);
+    int  sendZygote(const std::vector<std::string>& argv, const std::vector<char*>& env, const std::string& cwd);
+    void dropZygote(int err);
+    void record(const std::string& name, std::chrono::steady_clock::time_point start, int err);
+
+    int        zygoteFd  = -1;
+    pid_t      zygotePid = -1;
+    EventLoop* loop      = nullptr;
+
+    // Requests the zygote hasn't answered yet, oldest first; it handles them in order
+    struct Pending {
+        std::string                           name;
+        std::chrono::steady_clock::time_point sent;
+    };
+    std::deque<Pending> pending;
+};
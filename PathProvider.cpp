@@ -0,0 +1,139 @@
+#include "PathProvider.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "BinIO.hpp"
+#include "Xdg.hpp"
+
+namespace fs = std::filesystem;
+
+static constexpr uint32_t pathMagic   = 0x48545056; // "VPTH"
+static constexpr uint32_t pathVersion = 1;
+
+static int64_t mtimeOf(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return -1;
+    return int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+static std::string cacheFile() { return xdg::cacheHome() + "/volund/path.cache"; }
+
+PathProvider::PathProvider() : inotifyFd{inotify_init1(IN_NONBLOCK | IN_CLOEXEC)} {}
+
+PathProvider::~PathProvider() {
+    if (inotifyFd >= 0)
+        close(inotifyFd);
+}
+
+void PathProvider::scan() {
+    std::vector<Dir> cached;
+    load(cacheFile(), cached);
+
+    bool dirty = false;
+    dirs.clear();
+
+    std::stringstream ss{xdg::env("PATH", "/usr/local/bin:/usr/bin:/bin")};
+    for (std::string path; std::getline(ss, path, ':');) {
+        auto mtime = mtimeOf(path);
+        if (path.empty() || mtime < 0)
+            continue;
+
+        if (inotifyFd >= 0)
+            inotify_add_watch(inotifyFd, path.c_str(),
+                              IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF);
+
+        auto hit = std::find_if(cached.begin(), cached.end(), [&](auto& dir) { return dir.path == path; });
+        if (hit != cached.end() && hit->mtime == mtime) {
+            dirs.push_back(std::move(*hit));
+            continue;
+        }
+
+        Dir             dir{path, mtime, {}};
+        std::error_code ec;
+        for (auto& f : fs::directory_iterator(path, ec)) {
+            auto status = f.status(ec);
+            if (ec || !fs::is_regular_file(status))
+                continue;
+            if ((status.permissions() & (fs::perms::owner_exec | fs::perms::group_exec | fs::perms::others_exec)) == fs::perms::none)
+                continue;
+            dir.names.push_back(f.path().filename());
+        }
+        dirs.push_back(std::move(dir));
+        dirty = true;
+    }
+
+    if (dirty || dirs.size() != cached.size())
+        save(cacheFile());
+}
+
+void PathProvider::addTo(AppDB& db) const {
+    std::unordered_set<std::string> seen;
+    for (auto& dir : dirs)
+        for (auto& name : dir.names)
+            if (seen.insert(name).second)
+                db.add(name, {name, "", App::Kind::Executable, {name}, ""});
+}
+
+bool PathProvider::changed() {
+    if (inotifyFd < 0)
+        return false;
+
+    bool any = false;
+    alignas(inotify_event) char buf[4096];
+    while (read(inotifyFd, buf, sizeof(buf)) > 0) any = true;
+    return any;
+}
+
+bool PathProvider::load(const std::string& file, std::vector<Dir>& cached) {
+    auto in = std::ifstream(file, std::ios::binary);
+
+    uint32_t magic, version, count;
+    if (!binio::read(in, magic) || !binio::read(in, version) || magic != pathMagic || version != pathVersion)
+        return false;
+    if (!binio::read(in, count))
+        return false;
+
+    cached.resize(count);
+    for (auto& dir : cached) {
+        uint32_t names;
+        if (!binio::readStr(in, dir.path) || !binio::read(in, dir.mtime) || !binio::read(in, names))
+            return cached.clear(), false;
+
+        dir.names.resize(names);
+        for (auto& name : dir.names)
+            if (!binio::readStr(in, name))
+                return cached.clear(), false;
+    }
+    return true;
+}
+
+void PathProvider::save(const std::string& file) const {
+    std::error_code ec;
+    fs::create_directories(fs::path(file).parent_path(), ec);
+
+    auto tmp = file + ".tmp";
+    {
+        auto out = std::ofstream(tmp, std::ios::binary | std::ios::trunc);
+        binio::write(out, pathMagic);
+        binio::write(out, pathVersion);
+        binio::write<uint32_t>(out, dirs.size());
+        for (auto& dir : dirs) {
+            binio::writeStr(out, dir.path);
+            binio::write(out, dir.mtime);
+            binio::write<uint32_t>(out, dir.names.size());
+            for (auto& name : dir.names) binio::writeStr(out, name);
+        }
+        if (!out)
+            return;
+    }
+    fs::rename(tmp, file, ec);
+}
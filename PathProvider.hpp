@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "AppDB.hpp"
+
+// Every executable on $PATH, for launching things that don't ship a .desktop file.
+// Directory listings are cached by mtime, and the directories are watched with inotify.
+class PathProvider {
+  public:
+    PathProvider();
+    ~PathProvider();
+
+    // Rescans only the directories whose mtime changed since the cache was written
+    void scan();
+
+    // Adds each name once (first $PATH directory wins, like the shell) as an Executable entry
+    void addTo(AppDB& db) const;
+
+    // Drains pending inotify events. True if any $PATH directory changed.
+    bool changed();
+
+    int watchFd() const { return inotifyFd; }
+
+  private:
+    struct Dir {
+        std::string              path;
+        int64_t                  mtime;
+        std::vector<std::string> names;
+    };
+
+    std::vector<Dir> dirs;
+    int              inotifyFd;
+
+    bool load(const std::string& file, std::vector<Dir>& cached);
+    void save(const std::string& file) const;
+};
@@ -1,11 +1,25 @@
 #include "Picker.hpp"
 
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
-#include <regex>
+#include <mutex>
 #include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <SDL2/SDL.h>
 
+#include "AllocCount.hpp"
+#include "Hash.hpp"
+#include "Xdg.hpp"
 #include "glad.h"
 
 #define NK_INCLUDE_FIXED_TYPES
@@ -15,30 +29,196 @@
 #define NK_INCLUDE_VERTEX_BUFFER_OUTPUT
 #define NK_INCLUDE_FONT_BAKING
 #define NK_INCLUDE_DEFAULT_FONT
+#define NK_UINT_DRAW_INDEX // A few thousand result rows are more than 65535 vertices
 #define NK_IMPLEMENTATION
 #define NK_SDL_GL3_IMPLEMENTATION
+#define NK_SDL_RENDERER_IMPLEMENTATION
 #include "nuklear.h"
 #include "nuklear_sdl_gl3.h"
+#include "nuklear_sdl_renderer.h"
 
 int searchFilter(const struct nk_text_edit*, nk_rune unicode) { return nk_true; }
 
 
 
-void Picker::escapeString(std::string& str) {
-    std::stringstream ss;
+extern bool shown;
+
+// For the backends' own buffers, so their growth shows up in the allocation counts
+static void* nkCountedAlloc(nk_handle, void*, nk_size size) { return alloccount::countedMalloc(size); }
+static void  nkFree(nk_handle, void* ptr) { free(ptr); }
+
+// nuklear takes window, panel and table state from the back of the arena in the middle of a
+// frame, and unlike running out at the front, that isn't survivable: nk_begin asserts, and a panel
+// that doesn't fit is dereferenced anyway. Filling the freelist, which nuklear always tries first,
+// while the arena is still empty means a full arena only ever truncates the frame's commands.
+static void reservePageElements(nk_context* ctx) {
+    nk_page_element* elems[Picker::pageReserve];
+    int              count = 0;
+    // With room to spare for alignment, since a failed allocation asserts too
+    while (count < Picker::pageReserve && ctx->memory.size - ctx->memory.allocated >= 2 * sizeof(nk_page_element))
+        elems[count++] = nk_create_page_element(ctx);
+    while (count) nk_free_page_element(ctx, elems[--count]);
+}
+
+static constexpr uint32_t fontMagic   = 0x544e4656; // "VFNT"
+static constexpr uint32_t fontVersion = 2;
+
+// Header, glyphs, pixels; read back through an mmap, so each part starts suitably aligned
+struct FontCacheHeader {
+    uint32_t          magic, version;
+    uint64_t          key;
+    uint32_t          glyphSize; // Guards against nuklear's structs changing under an old cache
+    uint32_t          headerSize;
+    nk_sdl_baked_font font;
+};
+
+static void saveFontCache(const nk_sdl_baked_font* font, void* userdata) {
+    auto& key = *static_cast<Picker::FontCacheKey*>(userdata);
 
-    static const std::string escaped = R"~(\|()[]^${}*+?)~";
-    for (char c : str) {
-        if (escaped.find(c) != escaped.npos) ss << '\\';
-        ss << c;
+    FontCacheHeader header = {fontMagic, fontVersion, key.hash, sizeof(nk_font_glyph), sizeof(FontCacheHeader), *font};
+    header.font.pixels     = nullptr;
+    header.font.glyphs     = nullptr;
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(key.file).parent_path(), ec);
+    auto tmp = key.file + ".tmp";
+    {
+        auto out = std::ofstream(tmp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(font->glyphs), sizeof(nk_font_glyph) * font->glyph_count);
+        out.write(static_cast<const char*>(font->pixels), size_t(font->tex_width) * font->tex_height * 4);
+        if (!out)
+            return;
     }
+    std::filesystem::rename(tmp, key.file, ec);
+}
 
-    str = ss.str();
+static bool restoreFontCache(const Picker::FontCacheKey& key) {
+    int fd = open(key.file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    size_t      size = fstat(fd, &st) == 0 ? st.st_size : 0;
+    void*       map  = size >= sizeof(FontCacheHeader) ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    FontCacheHeader header;
+    memcpy(&header, map, sizeof(header));
+    size_t glyphBytes = sizeof(nk_font_glyph) * size_t(std::max(header.font.glyph_count, 0));
+    size_t pixelBytes = size_t(std::max(header.font.tex_width, 0)) * std::max(header.font.tex_height, 0) * 4;
+
+    bool ok = header.magic == fontMagic && header.version == fontVersion && header.key == key.hash &&
+              header.glyphSize == sizeof(nk_font_glyph) && header.headerSize == sizeof(FontCacheHeader) &&
+              size == sizeof(header) + glyphBytes + pixelBytes;
+    if (ok) {
+        header.font.glyphs = reinterpret_cast<const nk_font_glyph*>(static_cast<const char*>(map) + sizeof(header));
+        header.font.pixels = static_cast<const char*>(map) + sizeof(header) + glyphBytes;
+        ok                 = nk_sdl_font_stash_restore(&header.font);
+    }
+    munmap(map, size);
+    return ok;
 }
 
-extern bool shown;
+const char* const Picker::backendNames[] = {"gl", "renderer", "software"};
+
+static void uploadIconTexture(unsigned tex, const IconAtlasImage& img) {
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, img.width, img.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, img.pixels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    nk_sdl_set_icon_texture(tex);
+}
 
-Picker::Picker(const AppList& newList) : list{newList} {
+// Triple-buffered mailbox between the UI thread, which converts into `back`, and the render thread,
+// which draws `front`. Publishing swaps back and ready, so the UI thread never waits on a draw or a
+// swap, and the render thread always picks up the newest frame, skipping any it was too slow for.
+// The GL context belongs to the render thread for as long as this exists.
+struct RenderThread {
+    nk_sdl_frame frames[3];
+    int          back = 0, ready = 1, front = 2;
+    bool         fresh = false, stopping = false;
+    unsigned     dropped = 0; // Published frames replaced before they were drawn
+
+    unsigned                              iconTex;
+    std::shared_ptr<const IconAtlasImage> icons; // To upload before the next draw
+
+    std::mutex              mutex;
+    std::condition_variable wake;
+    std::thread             thread;
+
+    RenderThread(SDL_Window* window, SDL_GLContext glCtx, unsigned iconTex) : iconTex{iconTex} {
+        for (auto& frame : frames) nk_sdl_frame_init(&frame);
+        SDL_GL_MakeCurrent(window, nullptr);
+        thread = std::thread(&RenderThread::run, this, window, glCtx);
+    }
+
+    ~RenderThread() {
+        {
+            std::lock_guard lock{mutex};
+            stopping = true;
+        }
+        wake.notify_one();
+        thread.join();
+        for (auto& frame : frames) nk_sdl_frame_free(&frame);
+    }
+
+    // frames[back] is complete
+    void publish() {
+        {
+            std::lock_guard lock{mutex};
+            std::swap(back, ready);
+            dropped += fresh;
+            fresh = true;
+        }
+        wake.notify_one();
+    }
+
+    void setIcons(std::shared_ptr<const IconAtlasImage> img) {
+        std::lock_guard lock{mutex};
+        icons = std::move(img);
+    }
+
+    void run(SDL_Window* window, SDL_GLContext glCtx) {
+        SDL_GL_MakeCurrent(window, glCtx);
+        while (true) {
+            std::shared_ptr<const IconAtlasImage> upload;
+            {
+                std::unique_lock lock{mutex};
+                wake.wait(lock, [&] { return fresh || stopping; });
+                if (stopping)
+                    break;
+                std::swap(ready, front);
+                fresh = false;
+                upload.swap(icons);
+            }
+            if (upload)
+                uploadIconTexture(iconTex, *upload);
+
+            glClear(GL_COLOR_BUFFER_BIT);
+            glClearColor(0.5, 0.5, 0.5, 0.5);
+            nk_sdl_render_frame(&frames[front]);
+            SDL_GL_SwapWindow(window);
+        }
+        SDL_GL_MakeCurrent(window, nullptr);
+    }
+};
+
+// builtIn says whether it had to fall back to ProggyClean, even though file was set
+static nk_font* addFont(nk_font_atlas* atlas, const std::string& file, float size, const struct nk_font_config* cfg, bool& builtIn) {
+    nk_font* font = nullptr;
+    if (!file.empty() && !(font = nk_font_atlas_add_from_file(atlas, file.c_str(), size, cfg)))
+        std::cerr << "Couldn't load font " << file << ", using the built-in one\n";
+    builtIn = !font && !file.empty();
+    if (!font)
+        font = nk_font_atlas_add_default(atlas, size, cfg);
+    return font;
+}
+
+Picker::Picker(const AppDB& db, Launcher& launcher, IconAtlas* icons, EventLoop* loop) : db{db}, launcher{launcher}, loop{loop}, icons{icons} {
+    auto initStart = std::chrono::steady_clock::now();
     searchText.resize(128);
 
     keyMaps.insert({SDLK_ESCAPE, [&]() {
@@ -52,113 +232,532 @@ Picker::Picker(const AppList& newList) : list{newList} {
 
     keyMaps.insert({SDLK_RETURN, [&]() {
                         searchText[0] = '\0';
-                        if (toDisplay[0]) system(("setsid " + toDisplay[0]->second + '&').c_str());
+                        if (!toDisplay.empty()) launch(toDisplay[0]);
                         shown = false;
                         return true;
                     }});
 
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+    auto zoomKey = [&](float z) {
+        return [this, z]() {
+            if (!(SDL_GetModState() & KMOD_CTRL))
+                return true;
+            setZoom(z ? zoom * z : 1);
+            return false;
+        };
+    };
+    keyMaps.insert({SDLK_EQUALS, zoomKey(1.25f)});
+    keyMaps.insert({SDLK_PLUS, zoomKey(1.25f)});
+    keyMaps.insert({SDLK_KP_PLUS, zoomKey(1.25f)});
+    keyMaps.insert({SDLK_MINUS, zoomKey(0.8f)});
+    keyMaps.insert({SDLK_KP_MINUS, zoomKey(0.8f)});
+    keyMaps.insert({SDLK_0, zoomKey(0)});
+
+    auto backendName = xdg::env("VOLUND_BACKEND", "gl");
+    if (backendName == "renderer")
+        backend = Backend::Renderer;
+    else if (backendName == "software")
+        backend = Backend::Software;
+    else if (backendName != "gl")
+        std::cerr << "Unknown $VOLUND_BACKEND " << backendName << ", using gl\n";
+    bool vsync = xdg::env("VOLUND_VSYNC", "1") != "0"; // 0 to measure frame times rather than the refresh rate
+
+    // Starts hidden so a persistent picker can be built at startup; show() maps it.
+    // On HiDPI the drawable is bigger than the window and both backends scale up to it.
+    auto createWindow = [&] {
+        Uint32 flags = SDL_WINDOW_BORDERLESS | SDL_WINDOW_HIDDEN | SDL_WINDOW_ALLOW_HIGHDPI;
+        if (backend == Backend::GL) {
+            SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG);
+            SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+            SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+            SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+            SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+            flags |= SDL_WINDOW_OPENGL;
+        }
+        window = SDL_CreateWindow("volund", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 600, 200, flags);
+        SDL_GetWindowSize(window, &windowSize.x, &windowSize.y);
+    };
+    createWindow();
+
+    if (backend == Backend::Renderer && !(renderer = SDL_CreateRenderer(window, -1, vsync ? SDL_RENDERER_PRESENTVSYNC : 0))) {
+        std::cerr << "Couldn't create an SDL renderer: " << SDL_GetError() << ", falling back to software\n";
+        backend = Backend::Software;
+    }
+    // The window has no GL flag yet, so falling back to gl means starting over with a new one
+    if (backend == Backend::Software && !(renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE))) {
+        std::cerr << "Couldn't create a software renderer: " << SDL_GetError() << ", falling back to gl\n";
+        SDL_DestroyWindow(window);
+        backend = Backend::GL;
+        createWindow();
+    }
 
-    Vec2<int> windowSize;
-    window = SDL_CreateWindow("volund", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 600, 200,
-                              SDL_WINDOW_OPENGL | SDL_WINDOW_BORDERLESS | SDL_WINDOW_SHOWN | SDL_WINDOW_INPUT_GRABBED);
+    if (backend == Backend::GL) {
+        glCtx = SDL_GL_CreateContext(window);
+        SDL_GL_MakeCurrent(window, glCtx);
 
-    SDL_GetWindowSize(window, &windowSize.x, &windowSize.y);
-    glCtx = SDL_GL_CreateContext(window);
-    SDL_GL_MakeCurrent(window, glCtx);
+        gladLoadGL();
+        SDL_GL_SetSwapInterval(vsync);
+    }
 
-    gladLoadGL();
-    glViewport(0, 0, windowSize.x, windowSize.y);
+    printTimings = std::getenv("VOLUND_TIMINGS");
 
-    ctx = nk_sdl_init(window);
-    {
+    static Uint32 type = SDL_RegisterEvents(1);
+    loopEvent          = type;
+
+    nk_allocator counted = {{nullptr}, nkCountedAlloc, nkFree};
+    nk_sdl_set_allocator(&counted);
+    nk_sdlr_set_allocator(&counted);
+    arena = std::make_unique<char[]>(arenaSize);
+    ctx   = backend == Backend::GL ? nk_sdl_init(window, arena.get(), arenaSize) : nk_sdlr_init(window, renderer, arena.get(), arenaSize);
+    reservePageElements(ctx);
+    loadFont();
+
+    // Last, everything above still needs the context on this thread
+    if (std::getenv("VOLUND_RENDER_THREAD")) {
+        if (backend == Backend::GL) {
+            glGenTextures(1, &iconTex);
+            renderThread = std::make_unique<RenderThread>(window, glCtx, iconTex);
+        } else
+            std::cerr << "$VOLUND_RENDER_THREAD only works with the gl backend\n";
+    }
+
+    initUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - initStart).count();
+}
+
+// Baking rasterizes every glyph of the font. A bake we've done before is instead an mmap of the
+// cache file and a texture upload, as long as the font file, size and display DPI are the same.
+// VOLUND_FONT picks a TTF file instead of the built-in ProggyClean, VOLUND_FONT_SIZE its pixel size.
+// VOLUND_SDF bakes a distance field at sdfScale times that size instead, which draws sharp at any
+// zoom or display scale. Meant for outline fonts; ProggyClean is a bitmap font and looks best without.
+// The SDL_Renderer backends have no shaders for a distance field and always bake, uncached.
+void Picker::loadFont() {
+    std::string file = xdg::env("VOLUND_FONT", "");
+    float       size = std::getenv("VOLUND_FONT_SIZE") ? atof(std::getenv("VOLUND_FONT_SIZE")) : 13.0f;
+    if (size <= 0)
+        size = 13.0f;
+    fontSize = size;
+
+    if (backend != Backend::GL) {
         nk_font_atlas* atlas;
+        bool           builtIn;
+        nk_sdlr_font_stash_begin(&atlas);
+        atlas->default_font = addFont(atlas, file, size, nullptr, builtIn);
+        nk_sdlr_font_stash_end();
+        setZoom(zoom);
+        return;
+    }
+
+    int   spread   = std::getenv("VOLUND_SDF") ? sdfSpread : 0;
+    float bakeSize = spread ? size * sdfScale : size;
+    nk_sdl_font_sdf(spread);
+
+    float dpi = 0;
+    SDL_GetDisplayDPI(SDL_GetWindowDisplayIndex(window), &dpi, nullptr, nullptr);
+
+    struct stat st    = {};
+    int64_t     mtime = !file.empty() && stat(file.c_str(), &st) == 0 ? int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec : 0;
+
+    FontCacheKey key{};
+    key.hash         = fnv1a(fnvBasis, file.data(), file.size());
+    key.hash         = fnv1a(key.hash, &mtime, sizeof(mtime));
+    key.hash         = fnv1a(key.hash, &size, sizeof(size));
+    key.hash         = fnv1a(key.hash, &dpi, sizeof(dpi));
+    key.hash         = fnv1a(key.hash, &spread, sizeof(spread));
+    key.file         = xdg::cacheHome() + "/volund/font.atlas";
+
+    if (!restoreFontCache(key)) {
+        // The distance field does the filtering, so glyphs are rasterized once at their real size
+        struct nk_font_config cfg = nk_font_config(bakeSize);
+        if (spread)
+            cfg.oversample_h = cfg.oversample_v = 1;
+
+        nk_font_atlas* atlas;
+        bool           builtIn;
         nk_sdl_font_stash_begin(&atlas);
-        nk_sdl_font_stash_end();
+        atlas->default_font = addFont(atlas, file, bakeSize, &cfg, builtIn);
+        // Not cached under the broken font's key, or every later start would quietly restore the
+        // fallback without saying why
+        if (builtIn)
+            nk_sdl_font_stash_end();
+        else
+            nk_sdl_font_stash_end_with(saveFontCache, &key);
     }
+    setZoom(zoom);
+}
+
+void Picker::setZoom(float z) {
+    zoom = std::clamp(z, 0.5f, 4.0f);
+    if (backend == Backend::GL)
+        nk_sdl_set_font_height(fontSize * zoom);
+    else
+        nk_sdlr_set_font_height(fontSize * zoom);
+    forceRender = true;
 }
 
 Picker::~Picker() {
-  nk_sdl_shutdown();
-  SDL_GL_DeleteContext(glCtx);
+  hide();
+  if (renderThread) {
+    renderThread.reset();
+    SDL_GL_MakeCurrent(window, glCtx);
+  }
+  if (iconTex)
+    glDeleteTextures(1, &iconTex);
+  if (iconTexture)
+    SDL_DestroyTexture(iconTexture);
+  if (backend == Backend::GL) {
+    nk_sdl_shutdown();
+    SDL_GL_DeleteContext(glCtx);
+  } else {
+    nk_sdlr_shutdown();
+    SDL_DestroyRenderer(renderer);
+  }
   SDL_DestroyWindow(window);
 }
 
-void Picker::updateSearch() {
-
-  if (searchText[0] == '\0' && searchText != prevText) {
-    toDisplay.clear();
-    for (const auto& app : list) toDisplay.push_back(&app);
-        prevText = searchText;
+// Everything the user could have changed last time goes back to how a fresh Picker starts out.
+// The window, GL context, shaders and font atlas all stay as they are.
+void Picker::show(const std::string& query) {
+    if (visible) {
+        setQuery(query);
+        return;
     }
+    visible = true;
 
-    else if (searchText[0] != '\0' && searchText != prevText) {
-        // std::cerr << "Checking against '";
-        auto txt = searchText;
-        escapeString(txt);
-        txt.erase(std::find(txt.begin(), txt.end(), '\0'), txt.end());
+    setQuery(query);
+    prevText.clear(); // Forces a fresh search, the catalog may have been reloaded while we were hidden
+    scrollToTop = true;
+    needsRedraw = true;
+    forceRender = true;
 
-        auto exp = "(.*)" + txt + "(.*)";
-        // std::cerr << "Updating top apps with expression '" << exp << "'\n";
-        auto regex = std::regex(exp, std::regex_constants::icase);
+    if (loop)
+        loopBridge = std::make_unique<SdlWakeBridge>(*loop, loopEvent);
 
-        std::cerr << "'\n";
+    SDL_ShowWindow(window);
+    SDL_RaiseWindow(window);
+    SDL_SetWindowGrab(window, SDL_TRUE);
+}
 
-        toDisplay.clear();
+void Picker::setQuery(const std::string& query) {
+    std::fill(searchText.begin(), searchText.end(), '\0');
+    query.copy(&searchText[0], searchText.size() - 1);
+    needsRedraw = true;
+}
 
-        for (const auto& app : list) {
-            if (std::regex_match(app.first, regex)) {
-                toDisplay.push_back(&app);
-            }
-        }
+void Picker::hide() {
+    if (!visible)
+        return;
+    visible = false;
+
+    SDL_SetWindowGrab(window, SDL_FALSE);
+    SDL_HideWindow(window);
+
+    // The bridge would compete with the hidden daemon's own wait on the loop
+    loopBridge.reset();
+    // These point into the catalog, which may be reloaded before the next show()
+    toDisplay.clear();
+    if (onTopResult)
+        onTopResult(nullptr);
+}
 
-        prevText = searchText;
+const char* const Picker::stageNames[NumStages] = {"input", "query", "search", "results", "render"};
+
+void Picker::update() {
+    if (!pollInput())
+        return;
+
+    FrameTimings frame;
+    auto         start = inputStart;
+    auto         lap   = [&](Stage stage) {
+        auto now        = std::chrono::steady_clock::now();
+        frame.us[stage] = std::chrono::duration_cast<std::chrono::microseconds>(now - start).count();
+        start           = now;
+    };
+    lap(Input);
+
+    // Input can run EventLoop handlers, which may well allocate; from here on, a frame that
+    // doesn't search, upload icons, launch or outgrow lastCmds shouldn't touch the heap
+    auto allocs         = alloccount::thisThread();
+    auto searchesBefore = searches;
+    auto iconsBefore    = iconImg;
+    auto cmdsCapacity   = lastCmds.capacity();
+    auto growthsBefore  = arenaGrowths;
+
+    layoutQuery();
+    lap(Query);
+    updateResults();
+    lap(Search);
+    layoutResults();
+    lap(Results);
+    auto layoutAllocs = alloccount::thisThread() - allocs;
+    render();
+    lap(Render);
+
+    bool steady = searches == searchesBefore && iconImg == iconsBefore && lastCmds.capacity() == cmdsCapacity &&
+                  arenaGrowths == growthsBefore && shown;
+    if (steady) {
+        allocStats.steadyFrames++;
+        allocStats.layout += layoutAllocs;
+        allocStats.render += alloccount::thisThread() - allocs - layoutAllocs;
     }
 
+    frames++;
+    searchesOverBudget += frame.us[Search] > searchBudgetUs;
+    lastFrame = frame;
+    for (int stage = 0; stage < NumStages; stage++) worstFrame.us[stage] = std::max(worstFrame.us[stage], frame.us[stage]);
+
+    if (printTimings) {
+        std::cerr << "frame " << frames << ':';
+        for (int stage = 0; stage < NumStages; stage++) std::cerr << ' ' << stageNames[stage] << ' ' << frame.us[stage] << "us";
+        std::cerr << '\n';
+    }
+}
+
+bool Picker::pollInput() {
+    bool dirty = needsRedraw || searchText != prevText;
+    needsRedraw = false;
+
+    if (icons && icons->latest() != iconImg)
+        dirty = true;
+
     nk_input_begin(ctx);
 
+    // Nothing changed since the last frame, so sleep until something does instead of redrawing it
     SDL_Event ev;
-    while (SDL_PollEvent(&ev)) {
-        if (ev.type == SDL_QUIT)
-            shown = false;
-        else if (ev.type == SDL_KEYDOWN && tryHandleKey(keyMaps, ev.key.keysym.sym)) {
-        } else
-            nk_sdl_handle_event(&ev);
+    bool      gotEvent = dirty ? SDL_PollEvent(&ev) : loop ? SDL_WaitEvent(&ev) : SDL_WaitEventTimeout(&ev, idleTimeoutMs);
+    inputStart = std::chrono::steady_clock::now();
+    if (gotEvent) {
+        dirty = true;
+        do {
+            if (loop && ev.type == loopEvent) {
+                loop->runOnce(0);
+                loopBridge->rearm();
+            } else if (ev.type == SDL_QUIT)
+                shown = false;
+            else if (ev.type == SDL_WINDOWEVENT) {
+                SDL_GetWindowSize(window, &windowSize.x, &windowSize.y);
+                forceRender = true; // Exposed or resized: the old image may be gone even if the UI isn't
+            }
+            else if (ev.type == SDL_KEYDOWN && tryHandleKey(keyMaps, ev.key.keysym.sym)) {
+            } else if (backend == Backend::GL)
+                nk_sdl_handle_event(&ev);
+            else
+                nk_sdlr_handle_event(&ev);
+        } while (SDL_PollEvent(&ev));
     }
     nk_input_end(ctx);
+
+    return dirty;
 }
 
-void Picker::draw() {
-    if (nk_begin(ctx, "volund", nk_rect(0, 0, windowSize.x, windowSize.y), 0)) {
-        nk_layout_row_dynamic(ctx, 25, 1);
-        nk_edit_focus(ctx, NK_EDIT_ALWAYS_INSERT_MODE);
-        nk_edit_string_zero_terminated(ctx, NK_EDIT_FIELD, &searchText[0], 127, searchFilter);
+void Picker::layoutQuery() {
+    windowOpen = nk_begin(ctx, "volund", nk_rect(0, 0, windowSize.x, windowSize.y), NK_WINDOW_NO_SCROLLBAR);
+    if (!windowOpen)
+        return;
 
-        bool first = true;
-        for (auto& app : toDisplay) {
-            nk_layout_row_dynamic(ctx, 25.0, 1);
-            if (nk_button_label(ctx, (first ? (std::string{">>  "} + app->first + "  <<").c_str() : app->first.c_str()))) {
-                system(("setsid " + app->second + '&').c_str());
-                shown = false;
-                goto cleanupLoopIter; // Our Bjorne who art in heaven above forgive me
-            }
+    nk_layout_row_dynamic(ctx, scaled(rowHeight), 1);
+    nk_edit_focus(ctx, NK_EDIT_ALWAYS_INSERT_MODE);
+    nk_edit_string_zero_terminated(ctx, NK_EDIT_FIELD, &searchText[0], 127, searchFilter);
+}
+
+void Picker::updateResults() {
+    if (searchText == prevText)
+        return;
+
+    db.search(searchText.c_str(), toDisplay);
+    searches++;
+    prevText    = searchText;
+    scrollToTop = true;
+    if (onTopResult)
+        onTopResult(toDisplay.empty() ? nullptr : &toDisplay[0]->second);
+}
+
+// A fixed arena can't grow in place, window state at the back points into it. So nuklear starts
+// over on one twice the size, and the frame that didn't fit is laid out again straight away.
+void Picker::growArena() {
+    arenaSize *= 2;
+    auto bigger = std::make_unique<char[]>(arenaSize);
+    auto font   = ctx->style.font;
+    auto clip   = ctx->clip;
+    nk_free(ctx);
+    nk_init_fixed(ctx, bigger.get(), arenaSize, font);
+    reservePageElements(ctx);
+    ctx->clip = clip;
+    arena     = std::move(bigger);
+    arenaGrowths++;
+    needsRedraw = forceRender = true;
+    std::cerr << "UI arena grown to " << arenaSize / 1024 << " KiB\n";
+}
 
-            first = false;
+Picker::MemoryStats Picker::memoryStats() const {
+    MemoryStats stats = {arenaSize, arenaHighWater, 0, 0, arenaGrowths};
+    nk_size     highWater, size;
+    if (backend == Backend::GL)
+        nk_sdl_cmds_usage(&highWater, &size);
+    else
+        nk_sdlr_cmds_usage(&highWater, &size);
+    stats.cmdsSize      = size;
+    stats.cmdsHighWater = highWater;
+    return stats;
+}
+
+unsigned Picker::droppedFrames() const {
+    if (!renderThread)
+        return 0;
+    std::lock_guard lock{renderThread->mutex};
+    return renderThread->dropped;
+}
+
+void Picker::launch(AppList::const_pointer app) {
+    if (launcher.launch(app->second) && onLaunched)
+        onLaunched(app->first);
+}
+
+// Only ever uploads; decoding happened on IconAtlas's thread (or not at all, if it came from the cache)
+void Picker::uploadIcons() {
+    if (!icons)
+        return;
+
+    auto latest = icons->latest();
+    if (!latest || latest == iconImg)
+        return;
+    iconImg = std::move(latest);
+    forceRender = true; // Same commands, different pixels behind them
+
+    if (backend != Backend::GL) {
+        // The atlas can change size, so it's a new texture rather than an update
+        if (iconTexture)
+            SDL_DestroyTexture(iconTexture);
+        iconTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, iconImg->width, iconImg->height);
+        SDL_UpdateTexture(iconTexture, nullptr, iconImg->pixels.data(), iconImg->width * 4);
+        SDL_SetTextureBlendMode(iconTexture, SDL_BLENDMODE_BLEND);
+        return;
+    }
+
+    if (renderThread) {
+        renderThread->setIcons(iconImg); // Uploaded there ahead of the first frame that uses it
+        return;
+    }
+    if (!iconTex)
+        glGenTextures(1, &iconTex);
+    uploadIconTexture(iconTex, *iconImg);
+}
+
+void Picker::drawIcon(const std::string& name) {
+    if (iconImg) {
+        auto cell = iconImg->cells.find(name);
+        if (cell != iconImg->cells.end()) {
+            auto size = iconImg->cellSize;
+            auto rect = nk_rect(cell->second.x, cell->second.y, size, size);
+            nk_image(ctx, iconTexture ? nk_subimage_ptr(iconTexture, iconImg->width, iconImg->height, rect)
+                                      : nk_subimage_id(iconTex, iconImg->width, iconImg->height, rect));
+            return;
         }
     }
+    nk_spacing(ctx, 1);
+}
+
+// Only the rows in view (plus a couple below, for the one cut off at the bottom) become widgets,
+// so layout and convert cost the same for 10 matches as for every app there is
+void Picker::layoutResults() {
+    uploadIcons();
+
+    if (windowOpen) {
+        int  row        = int(scaled(rowHeight));
+        auto listHeight = nk_window_get_content_region(ctx).h - row - ctx->style.window.spacing.y;
+        nk_layout_row_dynamic(ctx, std::max(listHeight, float(row)), 1);
 
-cleanupLoopIter:
+        if (scrollToTop) {
+            scrollToTop = false;
+            if (auto y = nk_find_value(ctx->current, nk_murmur_hash("results", 7, NK_PANEL_GROUP) + 1))
+                *y = 0;
+        }
+
+        nk_list_view view;
+        if (nk_list_view_begin(ctx, &view, "results", 0, row, int(toDisplay.size()))) {
+            int end = std::min(int(toDisplay.size()), view.end + listOverscan);
+            for (int i = view.begin; i < end; i++) {
+                auto app = toDisplay[i];
+                nk_layout_row_template_begin(ctx, row);
+                nk_layout_row_template_push_static(ctx, row);
+                nk_layout_row_template_push_dynamic(ctx);
+                nk_layout_row_template_push_static(ctx, scaled(150));
+                nk_layout_row_template_end(ctx);
+
+                drawIcon(app->second.icon);
+
+                // The best match looks like a hovered button rather than getting decorated text
+                bool best = i == 0;
+                if (best) {
+                    nk_style_push_style_item(ctx, &ctx->style.button.normal, ctx->style.button.hover);
+                    nk_style_push_color(ctx, &ctx->style.button.text_normal, ctx->style.button.text_hover);
+                }
+                bool clicked = nk_button_label(ctx, app->first.c_str());
+                if (best) {
+                    nk_style_pop_style_item(ctx);
+                    nk_style_pop_color(ctx);
+                }
+                if (clicked) {
+                    launch(app);
+                    shown = false;
+                    break;
+                }
+
+                nk_label(ctx, app->second.icon.c_str(), NK_TEXT_LEFT);
+            }
+            nk_list_view_end(&view);
+        }
+    }
     nk_end(ctx);
+}
+
+// Mouse motion, focus changes and the like wake us up without changing anything on screen.
+// nuklear's command buffer fully describes the frame, so if it's byte for byte the same as last
+// time, so is the image, and convert, upload, draw and swap can all be skipped.
+void Picker::render() {
+    // Every allocation adds its size to needed; one that didn't fit adds nothing to the rest.
+    // needed is nuklear's own counter and we deliberately overwrite it: nk_clear takes off alignment
+    // padding it never added, so left alone it drifts below used and would hide a truncated frame.
+    // Nothing in nuklear depends on it beyond reporting it back through nk_buffer_info.
+    auto&  mem  = ctx->memory;
+    size_t used = mem.allocated + (mem.memory.size - mem.size);
+    arenaHighWater = std::max(arenaHighWater, used);
+    bool truncated = mem.needed > used;
+    mem.needed     = used;
+
+    int spare = 0;
+    for (auto elem = ctx->freelist; elem; elem = elem->next) spare++;
+    if (truncated || used > arenaSize / 4 * 3 || spare < pageReserve / 2) {
+        growArena();
+        return;
+    }
+
+    auto   cmds = static_cast<const char*>(nk_buffer_memory_const(&ctx->memory));
+    size_t size = ctx->memory.allocated;
+    if (!forceRender && size == lastCmds.size() && memcmp(cmds, lastCmds.data(), size) == 0) {
+        nk_clear(ctx);
+        skippedFrames++;
+        return;
+    }
+    forceRender = false;
+    lastCmds.assign(cmds, cmds + size);
+
+    if (backend != Backend::GL) {
+        SDL_SetRenderDrawColor(renderer, 128, 128, 128, 128);
+        SDL_RenderClear(renderer);
+        // Antialiasing roughly triples the triangles, which the CPU rasterizer feels
+        nk_sdlr_render(backend == Backend::Software ? NK_ANTI_ALIASING_OFF : NK_ANTI_ALIASING_ON);
+        SDL_RenderPresent(renderer);
+        return;
+    }
+
+    if (renderThread) {
+        nk_sdl_convert(&renderThread->frames[renderThread->back], NK_ANTI_ALIASING_ON);
+        renderThread->publish();
+        return;
+    }
 
-    glViewport(0, 0, windowSize.x, windowSize.y);
     glClear(GL_COLOR_BUFFER_BIT);
     glClearColor(0.5, 0.5, 0.5, 0.5);
-    nk_sdl_render(NK_ANTI_ALIASING_ON, 9999999, 99999999);
+    nk_sdl_render(NK_ANTI_ALIASING_ON, 512 * 1024, 128 * 1024);
 
     SDL_GL_SwapWindow(window);
-    SDL_GetWindowSize(window, &windowSize.x, &windowSize.y);
 }
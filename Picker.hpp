@@ -1,4 +1,5 @@
 #pragma once
+#include <chrono>
 #include <functional>
 #include <vector>
 
@@ -6,29 +7,133 @@
 #include <SDL2/SDL_keycode.h>
 
 #include "AppDB.hpp"
+#include "EventLoop.hpp"
+#include "IconAtlas.hpp"
+#include "Launcher.hpp"
 
 struct nk_context;
+struct RenderThread;
 
 template <typename T> struct Vec2 { T x, y; };
 
 class Picker {
   public:
-    Picker(const AppList&);
+    Picker(const AppDB&, Launcher& launcher, IconAtlas* icons = nullptr, EventLoop* loop = nullptr);
     ~Picker();
 
-    void updateSearch();
-    void draw();
-    inline void update() {
-        updateSearch();
-        draw();
-    }
+    // A Picker is created hidden and can be shown and hidden any number of times
+    void show(const std::string& query = "");
+    void hide();
+    void setQuery(const std::string& query);
+
+    // One frame is a fixed pipeline, so a keystroke makes it through the edit box, the search and
+    // the result list within the frame that read it:
+    //   input:   drain SDL into nuklear; blocks while there's nothing new, until either SDL or the
+    //            EventLoop has something (or for up to idleTimeoutMs without a loop)
+    //   query:   lay out the edit box, which is where nuklear applies the typed text to searchText
+    //   search:  rerun the search if that changed the text
+    //   results: lay out the result rows
+    //   render:  convert, draw and swap
+    void update();
+
+    enum Stage { Input, Query, Search, Results, Render, NumStages };
+    static const char* const stageNames[NumStages];
+
+    bool pollInput(); // True if the frame would look different from the last one
+    void layoutQuery();
+    void updateResults();
+    void layoutResults();
+    void render();
+
+    // Per stage, in microseconds. Input only counts draining events, not the wait for them.
+    // VOLUND_TIMINGS prints every frame's to stderr.
+    struct FrameTimings {
+        uint64_t us[NumStages] = {};
+    };
+    FrameTimings lastFrame, worstFrame;
+    unsigned     frames = 0, searches = 0, searchesOverBudget = 0, skippedFrames = 0;
+    bool         printTimings = false;
+
+    static constexpr int rowHeight    = 25; // At zoom 1, like every other size in the layout
+    static constexpr int listOverscan = 2;
+    static constexpr size_t initialArenaSize = 64 * 1024;
+    // Windows, panels and state tables nuklear can take (512 bytes each) without touching the back
+    // of the arena; the picker uses about 5 at a time, and the arena grows once half are gone
+    static constexpr int pageReserve = 16;
+
+    // VOLUND_SDF bakes at sdfScale times the font size, with the distance field reaching sdfSpread texels
+    static constexpr float sdfScale  = 4;
+    static constexpr int   sdfSpread = 6;
+
+    // A search slower than this still lands in its own frame, but it's the first thing to fix if
+    // typing ever feels late
+    static constexpr uint64_t searchBudgetUs = 4000;
+
+    // Called with the new best match every time the results change; nullptr when there is none or on hide()
+    std::function<void(const App*)> onTopResult;
+    // Called with the catalog name of every app that was launched successfully
+    std::function<void(const std::string&)> onLaunched;
+
+    // For changes the picker can't see itself, like the catalog being reloaded under it
+    void invalidate() { needsRedraw = true; }
+    // Draws and presents the next frame even if nothing on it changed; for benchmarks
+    void repaint() { needsRedraw = forceRender = true; }
+
+    // VOLUND_BACKEND: gl (the default), renderer (SDL_Renderer with whatever driver SDL picks) or
+    // software (SDL's own CPU rasterizer). The last two never create a GL 3.3 context or load GL.
+    enum class Backend { GL, Renderer, Software };
+    Backend                  backend = Backend::GL;
+    static const char* const backendNames[];
+    uint64_t                 initUs = 0; // Constructor: window, context or renderer, font
+
+    // nuklear's context (the frame's commands at the front, window state at the back) runs on one
+    // fixed arena. A 600x200 picker measures about 4 KiB and a 2000px tall one 23 KiB, plus the 8 KiB
+    // pageReserve keeps back, so it starts well above that and only doubles if a frame comes within a
+    // quarter of the end or eats into the reserve, at the cost of nuklear's window state (scroll, edit
+    // cursor) starting over. Draw commands work the same way.
+    struct MemoryStats {
+        size_t   arenaSize, arenaHighWater, cmdsSize, cmdsHighWater;
+        unsigned arenaGrowths;
+    };
+    MemoryStats memoryStats() const;
+
+    // Heap allocations this thread made in frames that didn't search, upload icons, launch or grow a
+    // buffer, which should be none. Only counted in -Dalloc_count=true builds (see AllocCount.hpp).
+    struct AllocStats {
+        unsigned steadyFrames = 0;
+        uint64_t layout = 0, render = 0; // Query through results stages; render stage
+    } allocStats;
+
+    // Published frames a newer one replaced before the render thread got to them; 0 without one
+    unsigned droppedFrames() const;
+
+    // Upper bound on how stale `shown` can get while the window is idle, if there's no EventLoop to wake us
+    static constexpr int idleTimeoutMs = 250;
     inline bool tryHandleKey(std::unordered_map<SDL_Keycode, std::function<bool()>>& keyMaps, SDL_Keycode code) {
         return keyMaps.find(code) != keyMaps.end() && !keyMaps[code]();
     }
 
-    void escapeString(std::string& str);
+    // Where and under which key the baked font atlas is cached
+    struct FontCacheKey {
+        uint64_t    hash;
+        std::string file;
+    };
+    void loadFont();
+
+    // Ctrl+= / Ctrl+- / Ctrl+0. Text is only redrawn at the new size, never rebaked, so it stays
+    // sharp with VOLUND_SDF and gets blurry without.
+    void  setZoom(float z);
+    float scaled(float px) const { return px * zoom; }
+    float zoom = 1, fontSize = 13;
+
+    void growArena();
+
+    void launch(AppList::const_pointer app);
+    void uploadIcons();
+    void drawIcon(const std::string& name);
 
-    const AppList& list;
+    const AppDB& db;
+    Launcher&    launcher;
     std::vector<AppList::const_pointer> toDisplay;
 
     std::string searchText, prevText;
@@ -36,6 +141,33 @@ class Picker {
 
     std::unordered_map<SDL_Keycode, std::function<bool()>> keyMaps; // ret true if handled/consumed
     SDL_Window* window;
-    SDL_GLContext glCtx;
+    SDL_GLContext glCtx = nullptr;
+    SDL_Renderer* renderer = nullptr; // Instead of glCtx for the SDL_Renderer backends
     Vec2<int> windowSize;
+    bool      needsRedraw = true;
+    bool      visible     = false;
+    bool      windowOpen  = false; // What nk_begin said this frame
+    bool      scrollToTop = true;  // New results start from the best match
+    bool      forceRender = true;  // Draw and swap even if the commands match lastCmds
+
+    std::vector<char> lastCmds; // nuklear's command buffer as of the last frame actually drawn
+
+    // VOLUND_RENDER_THREAD (gl backend only): the render stage just converts, and a thread of its own
+    // uploads, draws and waits out the swap, so vsync or a slow GPU never holds up the next keystroke
+    std::unique_ptr<RenderThread> renderThread;
+
+    std::unique_ptr<char[]> arena;
+    size_t                  arenaSize = initialArenaSize, arenaHighWater = 0;
+    unsigned                arenaGrowths = 0;
+
+    std::chrono::steady_clock::time_point inputStart;
+
+    EventLoop*                     loop;
+    std::unique_ptr<SdlWakeBridge> loopBridge;
+    Uint32                         loopEvent = 0;
+
+    IconAtlas*                            icons;
+    std::shared_ptr<const IconAtlasImage> iconImg;
+    unsigned                              iconTex = 0;
+    SDL_Texture*                          iconTexture = nullptr; // iconTex for the SDL_Renderer backends
 };
@@ -0,0 +1,345 @@
+#include "Prefetcher.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <elf.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "Xdg.hpp"
+
+// Enough for any sane dependency tree without letting one weird binary read in half of /usr
+static constexpr size_t   maxFiles = 256;
+static constexpr uint64_t maxBytes = 256ull << 20;
+
+static constexpr unsigned char nativeClass = sizeof(void*) == 8 ? ELFCLASS64 : ELFCLASS32;
+
+static void readLdSoConf(const std::string& file, std::vector<std::string>& dirs, int depth = 0) {
+    auto in = std::ifstream(file);
+    for (std::string line; std::getline(in, line);) {
+        line = line.substr(0, line.find('#'));
+        std::stringstream ss{line};
+        std::string       word;
+        if (!(ss >> word))
+            continue;
+
+        if (word != "include") {
+            dirs.push_back(word);
+            continue;
+        }
+        while (depth < 4 && ss >> word) {
+            if (word[0] != '/')
+                word = "/etc/" + word;
+            glob_t g;
+            if (glob(word.c_str(), 0, nullptr, &g) == 0)
+                for (size_t i = 0; i < g.gl_pathc; i++) readLdSoConf(g.gl_pathv[i], dirs, depth + 1);
+            globfree(&g);
+        }
+    }
+}
+
+static bool isFile(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+// The calling thread only; everything else in volund keeps its normal priority
+static void lowerPriority() {
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), 19);
+    constexpr int ioprioWhoProcess = 1, ioprioClassIdle = 3, ioprioClassShift = 13;
+    syscall(SYS_ioprio_set, ioprioWhoProcess, 0, ioprioClassIdle << ioprioClassShift);
+}
+
+Prefetcher::Prefetcher() {
+    std::stringstream ss{xdg::env("LD_LIBRARY_PATH", "")};
+    for (std::string dir; std::getline(ss, dir, ':');)
+        if (!dir.empty())
+            libDirs.push_back(dir);
+    readLdSoConf("/etc/ld.so.conf", libDirs);
+    for (auto dir : {"/lib64", "/usr/lib64", "/lib", "/usr/lib"}) libDirs.push_back(dir);
+
+    if (auto delay = std::getenv("VOLUND_PREFETCH_DELAY_MS"))
+        stableMs = std::chrono::milliseconds(atoi(delay));
+
+    worker = std::thread(&Prefetcher::work, this);
+}
+
+Prefetcher::~Prefetcher() {
+    {
+        std::lock_guard lock{mutex};
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void Prefetcher::candidate(const App* app) {
+    {
+        std::lock_guard lock{mutex};
+        cancelWarm = true;
+        warmApps.clear();
+        hasPending = app && !app->argv.empty();
+        if (!hasPending)
+            return;
+        pendingArgv  = app->argv;
+        pendingCwd   = app->cwd;
+        pendingSince = std::chrono::steady_clock::now();
+    }
+    wake.notify_one();
+}
+
+Prefetcher::Stats Prefetcher::stats() const {
+    std::lock_guard lock{mutex};
+    return counters;
+}
+
+void Prefetcher::warm(std::vector<App> apps, uint64_t budget) {
+    {
+        std::lock_guard lock{mutex};
+        warmApps   = std::move(apps);
+        warmBudget = budget;
+        cancelWarm = false;
+    }
+    wake.notify_one();
+}
+
+void Prefetcher::stopWarming() {
+    std::lock_guard lock{mutex};
+    warmApps.clear();
+    cancelWarm = true;
+}
+
+// Load below half the cores, and (where the kernel has PSI) next to nobody stalled on IO
+bool Prefetcher::systemIdle() {
+    double load;
+    if (getloadavg(&load, 1) == 1 && load > 0.5 * sysconf(_SC_NPROCESSORS_ONLN))
+        return false;
+
+    auto        in = std::ifstream("/proc/pressure/io");
+    std::string some, avg10;
+    if (in >> some >> avg10 && avg10.rfind("avg10=", 0) == 0)
+        return atof(avg10.c_str() + 6) < 1.0;
+    return true;
+}
+
+void Prefetcher::work() {
+    lowerPriority();
+
+    while (true) {
+        std::string      exe, cwd;
+        std::vector<App> apps;
+        uint64_t         budget = 0;
+        {
+            std::unique_lock lock{mutex};
+            wake.wait(lock, [&] { return hasPending || !warmApps.empty() || stopping; });
+            if (stopping)
+                return;
+
+            // Typing always wins over idle warming
+            if (!hasPending) {
+                apps   = std::move(warmApps);
+                budget = warmBudget;
+                warmApps.clear();
+            } else {
+                // Wait out the typing: every newer candidate pushes the deadline back
+                while (!stopping && hasPending) {
+                    auto due = std::max(pendingSince + stableMs, lastRun + interval);
+                    if (std::chrono::steady_clock::now() >= due)
+                        break;
+                    wake.wait_until(lock, due);
+                }
+                if (stopping)
+                    return;
+                if (!hasPending)
+                    continue;
+                exe        = pendingArgv[0];
+                cwd        = pendingCwd;
+                hasPending = false;
+            }
+        }
+
+        if (!apps.empty()) {
+            warmUp(apps, budget);
+            continue;
+        }
+
+        exe = resolve(exe, cwd);
+        if (exe.empty())
+            continue;
+
+        auto now = std::chrono::steady_clock::now();
+        auto hit = done.find(exe);
+        if (hit != done.end() && now - hit->second < recent)
+            continue;
+        done[exe] = now;
+        lastRun   = now;
+
+        std::vector<std::string>        files{exe};
+        std::unordered_set<std::string> seen{exe};
+        addDeps(exe, files, seen);
+
+        unsigned numFiles = 0;
+        uint64_t bytes    = readIn(files, maxBytes, nullptr, numFiles);
+
+        std::lock_guard lock{mutex};
+        counters.prefetches++;
+        counters.files += numFiles;
+        counters.bytes += bytes;
+    }
+}
+
+// Libraries shared between the apps are only counted against the budget once
+void Prefetcher::warmUp(const std::vector<App>& apps, uint64_t budget) {
+    std::vector<std::string>        files;
+    std::unordered_set<std::string> seen;
+    for (auto& app : apps) {
+        auto exe = resolve(app.argv[0], app.cwd);
+        if (exe.empty() || !seen.insert(exe).second)
+            continue;
+        files.push_back(exe);
+        addDeps(exe, files, seen);
+    }
+
+    unsigned numFiles = 0;
+    uint64_t bytes    = readIn(files, budget, &cancelWarm, numFiles);
+
+    std::lock_guard lock{mutex};
+    counters.warms++;
+    counters.warmedFiles += numFiles;
+    counters.warmedBytes += bytes;
+}
+
+// Same lookup execvp does
+std::string Prefetcher::resolve(const std::string& exe, const std::string& cwd) {
+    std::string path = exe;
+    if (exe.find('/') == std::string::npos) {
+        path.clear();
+        std::stringstream ss{xdg::env("PATH", "/usr/local/bin:/usr/bin:/bin")};
+        for (std::string dir; path.empty() && std::getline(ss, dir, ':');)
+            if (!dir.empty() && access((dir + '/' + exe).c_str(), X_OK) == 0)
+                path = dir + '/' + exe;
+    } else if (exe[0] != '/' && !cwd.empty())
+        path = cwd + '/' + exe;
+    return !path.empty() && isFile(path) ? path : "";
+}
+
+// readahead()s whole files in order until the budget runs out. Goes in chunks so a cancel takes
+// effect within one chunk rather than after a whole (possibly huge) library.
+uint64_t Prefetcher::readIn(const std::vector<std::string>& files, uint64_t budget, const std::atomic<bool>* cancel, unsigned& numFiles) {
+    static constexpr off_t chunk = 2 << 20;
+
+    uint64_t bytes = 0;
+    for (auto& file : files) {
+        int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || bytes + st.st_size > budget) {
+            close(fd);
+            continue;
+        }
+        for (off_t off = 0; off < st.st_size && !(cancel && *cancel); off += chunk) readahead(fd, off, std::min(chunk, st.st_size - off));
+        close(fd);
+
+        if (cancel && *cancel)
+            break;
+        numFiles++;
+        bytes += st.st_size;
+    }
+    return bytes;
+}
+
+// Only the dynamic section and its string table get read: found through the section headers, so
+// there's no need to map virtual addresses back to file offsets
+void Prefetcher::addDeps(const std::string& path, std::vector<std::string>& files, std::unordered_set<std::string>& seen) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(ElfW(Ehdr))) {
+        close(fd);
+        return;
+    }
+    size_t size = st.st_size;
+    auto   map  = static_cast<const uint8_t*>(mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0));
+    close(fd);
+    if (map == MAP_FAILED)
+        return;
+
+    auto inBounds = [&](size_t off, size_t len) { return off <= size && len <= size - off; };
+
+    std::vector<std::string> needed, rpath, runpath;
+    auto ehdr = reinterpret_cast<const ElfW(Ehdr)*>(map);
+    if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) == 0 && ehdr->e_ident[EI_CLASS] == nativeClass &&
+        ehdr->e_shentsize == sizeof(ElfW(Shdr)) && inBounds(ehdr->e_shoff, size_t(ehdr->e_shnum) * sizeof(ElfW(Shdr)))) {
+        auto shdrs = reinterpret_cast<const ElfW(Shdr)*>(map + ehdr->e_shoff);
+        for (unsigned i = 0; i < ehdr->e_shnum; i++) {
+            auto& dyn = shdrs[i];
+            if (dyn.sh_type != SHT_DYNAMIC || dyn.sh_link >= ehdr->e_shnum || !inBounds(dyn.sh_offset, dyn.sh_size))
+                continue;
+            auto& strtab = shdrs[dyn.sh_link];
+            if (!inBounds(strtab.sh_offset, strtab.sh_size))
+                continue;
+
+            auto str = [&](size_t off) -> std::string {
+                if (off >= strtab.sh_size)
+                    return {};
+                auto s = reinterpret_cast<const char*>(map + strtab.sh_offset + off);
+                return std::string(s, strnlen(s, strtab.sh_size - off));
+            };
+            auto split = [&](const std::string& s, std::vector<std::string>& out) {
+                std::stringstream ss{s};
+                for (std::string dir; std::getline(ss, dir, ':');) out.push_back(dir);
+            };
+
+            auto entries = reinterpret_cast<const ElfW(Dyn)*>(map + dyn.sh_offset);
+            for (size_t j = 0; j < dyn.sh_size / sizeof(ElfW(Dyn)) && entries[j].d_tag != DT_NULL; j++) {
+                if (entries[j].d_tag == DT_NEEDED)
+                    needed.push_back(str(entries[j].d_un.d_val));
+                else if (entries[j].d_tag == DT_RPATH)
+                    split(str(entries[j].d_un.d_val), rpath);
+                else if (entries[j].d_tag == DT_RUNPATH)
+                    split(str(entries[j].d_un.d_val), runpath);
+            }
+            break;
+        }
+    }
+    munmap(const_cast<uint8_t*>(map), size);
+
+    // DT_RPATH is only honoured without a DT_RUNPATH, same as ld.so
+    auto& search = runpath.empty() ? rpath : runpath;
+    auto  origin = path.substr(0, path.rfind('/'));
+    for (auto& name : needed) {
+        if (files.size() >= maxFiles)
+            return;
+        auto lib = findLib(name, search, origin);
+        if (lib.empty() || !seen.insert(lib).second)
+            continue;
+        files.push_back(lib);
+        addDeps(lib, files, seen);
+    }
+}
+
+std::string Prefetcher::findLib(const std::string& name, const std::vector<std::string>& rpath, const std::string& origin) const {
+    if (name.find('/') != std::string::npos)
+        return isFile(name) ? name : "";
+
+    for (auto dirs : {&rpath, &libDirs})
+        for (auto dir : *dirs) {
+            auto pos = dir.find("$ORIGIN");
+            if (pos != std::string::npos)
+                dir.replace(pos, 7, origin);
+            auto path = dir + '/' + name;
+            if (isFile(path))
+                return path;
+        }
+    return {};
+}
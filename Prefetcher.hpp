@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "AppDB.hpp"
+
+// Pulls the binary of whatever is currently the top result into the page cache, together with
+// every shared library it links against, so it's warm by the time Return is pressed.
+// Between uses it can also warm a list of apps (see warm()).
+// Runs on its own thread at idle CPU and IO priority; only readahead()s, never touches the pages.
+class Prefetcher {
+  public:
+    Prefetcher();
+    ~Prefetcher();
+
+    // Called whenever the top result changes (nullptr when there is none). Prefetching starts
+    // once the same candidate has stayed on top for stableMs.
+    void candidate(const App* app);
+
+    // Reads in these apps' binaries and libraries, in order, until `budget` bytes have been read.
+    // Replaces any warming still queued; a new candidate() or stopWarming() cancels it mid-way.
+    void warm(std::vector<App> apps, uint64_t budget);
+    void stopWarming();
+
+    // Low load and, where the kernel reports it, little IO pressure
+    static bool systemIdle();
+
+    std::chrono::milliseconds stableMs{150};
+    // No more than one prefetch per interval, and the same binary at most once per `recent`
+    std::chrono::milliseconds interval{250};
+    std::chrono::seconds      recent{30};
+
+    struct Stats {
+        unsigned prefetches = 0, files = 0, warms = 0, warmedFiles = 0;
+        uint64_t bytes = 0, warmedBytes = 0;
+    };
+    Stats stats() const;
+
+  private:
+    void work();
+    void warmUp(const std::vector<App>& apps, uint64_t budget);
+    uint64_t readIn(const std::vector<std::string>& files, uint64_t budget, const std::atomic<bool>* cancel, unsigned& numFiles);
+    static std::string resolve(const std::string& exe, const std::string& cwd);
+
+    // Every DT_NEEDED of the ELF file at path, resolved to a file, recursively
+    void addDeps(const std::string& path, std::vector<std::string>& files, std::unordered_set<std::string>& seen);
+    std::string findLib(const std::string& name, const std::vector<std::string>& rpath, const std::string& origin) const;
+
+    std::vector<std::string> libDirs; // LD_LIBRARY_PATH, ld.so.conf, then the defaults
+
+    mutable std::mutex                     mutex;
+    std::condition_variable                wake;
+    std::vector<std::string>               pendingArgv;
+    std::string                            pendingCwd;
+    std::chrono::steady_clock::time_point  pendingSince;
+    bool                                   hasPending = false, stopping = false;
+    Stats                                  counters;
+    std::vector<App>                       warmApps;
+    uint64_t                               warmBudget = 0;
+    std::atomic<bool>                      cancelWarm{false};
+
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> done;
+    std::chrono::steady_clock::time_point                                  lastRun;
+
+    std::thread worker;
+};
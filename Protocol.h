@@ -0,0 +1,41 @@
+#pragma once
+/* Wire format shared by the daemon and volund-msg. Plain C so the client doesn't pull in libstdc++.
+ *
+ * Every message, in both directions, is a volund_msg_header followed by `length` payload bytes.
+ * The client sends one request, the daemon sends one reply and closes the connection. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+enum volund_op {
+    VOLUND_OP_TOGGLE = 1, /* no payload */
+    VOLUND_OP_SHOW   = 2, /* payload: initial query, may be empty */
+    VOLUND_OP_RELOAD = 3, /* no payload */
+    VOLUND_OP_STATS  = 4, /* reply payload: "key: value" lines */
+    VOLUND_OP_QUERY  = 5, /* payload: query; reply payload: one "name\texec" line per match, best first */
+};
+
+enum volund_status {
+    VOLUND_STATUS_OK    = 0,
+    VOLUND_STATUS_ERROR = 1, /* reply payload: message */
+};
+
+struct volund_msg_header {
+    uint8_t  op;
+    uint8_t  status;
+    uint16_t reserved;
+    uint32_t length;
+};
+
+#define VOLUND_MAX_PAYLOAD (16u << 20)
+
+/* $XDG_RUNTIME_DIR/volund.sock, or a per-user path in /tmp without one */
+static inline void volund_socket_path(char* out, size_t size) {
+    const char* runtime = getenv("XDG_RUNTIME_DIR");
+    if (runtime && *runtime)
+        snprintf(out, size, "%s/volund.sock", runtime);
+    else
+        snprintf(out, size, "/tmp/volund-%u.sock", (unsigned)getuid());
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Bare minimum of the XDG base directory spec that volund needs.
+namespace xdg {
+inline std::string env(const char* name, const std::string& fallback) {
+    auto val = std::getenv(name);
+    return val && *val ? val : fallback;
+}
+
+inline std::string home() { return env("HOME", "/"); }
+
+inline std::string dataHome() { return env("XDG_DATA_HOME", home() + "/.local/share"); }
+
+inline std::string cacheHome() { return env("XDG_CACHE_HOME", home() + "/.cache"); }
+
+inline std::string configHome() { return env("XDG_CONFIG_HOME", home() + "/.config"); }
+
+inline std::vector<std::string> dataDirs() {
+    std::vector<std::string> dirs;
+    std::stringstream        ss{env("XDG_DATA_DIRS", "/usr/local/share:/usr/share")};
+    for (std::string dir; std::getline(ss, dir, ':');)
+        if (!dir.empty())
+            dirs.push_back(dir);
+    return dirs;
+}
+} // namespace xdg
@@ -0,0 +1,226 @@
+// Times a full AppDB::addPath over a directory of .desktop files with each available loader,
+// first with the files evicted from the page cache and then again with them warm. Also times
+// INIFile::parse on its own, and $PATH startup with and without PathProvider's cache.
+//   bench_load [count|dir] [iterations]
+// A count (the default is 2000) generates that many synthetic .desktop files in a temporary tree
+// under $VOLUND_BENCH_DIR, or /var/tmp: it has to be disk backed for the cold runs to mean anything.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/magic.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#include "AppDB.hpp"
+#include "PathProvider.hpp"
+#include "Xdg.hpp"
+#include "yaip.hpp"
+
+namespace fs = std::filesystem;
+
+static const char* const locales[] = {"af", "ar", "ast", "be", "bg", "bn", "br", "bs", "ca", "ca@valencia", "cs", "cy", "da", "de",
+                                      "el", "en_AU", "en_CA", "en_GB", "eo", "es", "et", "eu", "fa", "fi", "fr", "ga", "gl", "he",
+                                      "hi", "hr", "hu", "id", "is", "it", "ja", "ka", "kk", "km", "ko", "lt", "lv", "mk", "ml",
+                                      "mr", "ms", "nb", "nl", "nn", "oc", "pa", "pl", "pt", "pt_BR", "ro", "ru", "sk", "sl", "sr",
+                                      "sr@latin", "sv", "ta", "te", "th", "tr", "uk", "vi", "zh_CN", "zh_HK", "zh_TW"};
+
+// Shaped like what distros ship: most files have a handful of translations, the big desktop
+// suites carry dozens for every key and several actions
+static std::string desktopFile(std::mt19937& rng, unsigned i) {
+    auto name    = "App " + std::to_string(i);
+    auto exec    = "app-" + std::to_string(i);
+    int  nLocale = rng() % 4 == 0 ? 30 + rng() % 40 : rng() % 8;
+    int  nAction = rng() % 3 == 0 ? 1 + rng() % 4 : 0;
+
+    std::ostringstream out;
+    auto               localized = [&](const char* key, const std::string& value) {
+        out << key << '=' << value << '\n';
+        for (int l = 0; l < nLocale; l++)
+            out << key << '[' << locales[l] << "]=" << value << " (" << locales[l] << ")\n";
+    };
+
+    out << "[Desktop Entry]\nType=Application\nVersion=1.0\n";
+    localized("Name", name);
+    localized("GenericName", "Generic Application");
+    localized("Comment", "Does the things application number " + std::to_string(i) + " is meant to do");
+    localized("Keywords", "tool;utility;example;");
+    out << "Exec=" << exec << " %U\nTryExec=" << exec << "\nIcon=" << exec << "\nTerminal=false\nStartupNotify=true\n";
+    out << "Categories=Utility;Development;\nMimeType=text/plain;text/html;application/xml;image/png;image/jpeg;\n";
+    if (nAction) {
+        out << "Actions=";
+        for (int a = 0; a < nAction; a++)
+            out << "action-" << a << ';';
+        out << '\n';
+    }
+
+    for (int a = 0; a < nAction; a++) {
+        out << "\n[Desktop Action action-" << a << "]\n";
+        localized("Name", "Action " + std::to_string(a));
+        out << "Exec=" << exec << " --action-" << a << '\n';
+    }
+    return out.str();
+}
+
+// Synced before returning: fadvise can't drop dirty or in-flight pages, which would make the
+// first cold runs warm
+static void writeTree(const std::string& dir, unsigned count) {
+    std::mt19937 rng(count);
+    fs::create_directories(dir);
+    for (unsigned i = 0; i < count; i++)
+        std::ofstream(dir + "/app-" + std::to_string(i) + ".desktop") << desktopFile(rng, i);
+
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        syncfs(fd);
+        close(fd);
+    }
+}
+
+// Empty files with the exec bit are all PathProvider looks at
+static void writeBinDir(const std::string& dir, unsigned count) {
+    fs::create_directories(dir);
+    for (unsigned i = 0; i < count; i++) {
+        auto file = dir + "/app-" + std::to_string(i);
+        std::ofstream{file};
+        chmod(file.c_str(), 0755);
+    }
+}
+
+// Only drops clean pages, so a generated tree has to be synced first (writeTree does)
+static void dropCache(const std::vector<std::string>& files) {
+    for (auto& f : files) {
+        int fd = open(f.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+static double timeMs(const std::function<void()>& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static long peakRssKb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static void report(const std::string& scenario, size_t files, size_t bytes, const std::vector<double>& ms) {
+    double best = *std::min_element(ms.begin(), ms.end()), total = 0;
+    for (double m : ms)
+        total += m;
+
+    std::cout << "{" << scenario << ", \"files\": " << files << ", \"best_ms\": " << best << ", \"mean_ms\": " << total / ms.size()
+              << ", \"files_per_s\": " << files / (best / 1000) << ", \"mb_per_s\": " << bytes / (best / 1000) / 1e6
+              << ", \"peak_rss_kb\": " << peakRssKb() << "}\n";
+}
+
+int main(int argc, char** argv) {
+    std::string arg        = argc > 1 ? argv[1] : "2000";
+    int         iterations = argc > 2 ? std::stoi(argv[2]) : 5;
+    if (iterations < 1) {
+        std::cerr << "Need at least one iteration\n";
+        return 1;
+    }
+
+    std::string tmp, dir = arg;
+    if (arg.find_first_not_of("0123456789") == std::string::npos) {
+        auto tmpl = xdg::env("VOLUND_BENCH_DIR", "/var/tmp") + "/bench_load.XXXXXX";
+        if (!mkdtemp(tmpl.data())) {
+            std::cerr << "Couldn't create a temporary directory in " << tmpl << '\n';
+            return 1;
+        }
+        tmp = tmpl;
+
+        struct statfs fsInfo;
+        if (statfs(tmp.c_str(), &fsInfo) == 0 && fsInfo.f_type == TMPFS_MAGIC)
+            std::cerr << tmp << " is on tmpfs, which has no page cache to drop; cold runs will be warm\n";
+        dir = tmp + "/applications";
+        writeTree(dir, std::stoul(arg));
+    }
+
+    std::vector<std::string> files;
+    for (auto& f : fs::directory_iterator(dir))
+        if (f.is_regular_file())
+            files.push_back(f.path());
+
+    std::vector<std::string> contents;
+    loadFiles(files, contents, LoadMethod::Stream);
+    size_t bytes = 0;
+    for (auto& c : contents)
+        bytes += c.size();
+
+    std::vector<std::pair<const char*, LoadMethod>> methods = {{"ifstream", LoadMethod::Stream}};
+    if (uringAvailable())
+        methods.push_back({"io_uring", LoadMethod::Uring});
+    else
+        std::cerr << "io_uring unavailable, only timing the ifstream path\n";
+
+    for (auto& [name, method] : methods) {
+        for (const char* scenario : {"cold", "warm"}) {
+            std::vector<double> ms;
+            for (int i = 0; i < iterations; i++) {
+                if (scenario[0] == 'c')
+                    dropCache(files);
+                AppDB db;
+                db.loadMethod = method;
+                ms.push_back(timeMs([&] { db.addPath(dir); }));
+            }
+            report(std::string("\"stage\": \"addPath\", \"loader\": \"") + name + "\", \"cache\": \"" + scenario + "\"", files.size(),
+                   bytes, ms);
+        }
+    }
+
+    // Same bytes, already in memory, so this is the parser and nothing else
+    std::vector<double> parseMs;
+    for (int i = 0; i < iterations; i++)
+        parseMs.push_back(timeMs([&] {
+            for (auto& content : contents) {
+                INIFile ini;
+                auto    in = std::istringstream(content);
+                ini.parse(in);
+            }
+        }));
+    report("\"stage\": \"parse\"", files.size(), bytes, parseMs);
+
+    // $PATH startup: a miss lists every directory and writes path.cache, a hit only stats them
+    if (!tmp.empty()) {
+        auto bin = tmp + "/bin";
+        writeBinDir(bin, files.size());
+        setenv("PATH", bin.c_str(), 1);
+        setenv("XDG_CACHE_HOME", (tmp + "/cache").c_str(), 1);
+
+        for (const char* scenario : {"miss", "hit"}) {
+            std::vector<double> ms;
+            for (int i = 0; i < iterations; i++) {
+                if (scenario[0] == 'm')
+                    fs::remove_all(tmp + "/cache");
+                AppDB db;
+                ms.push_back(timeMs([&] {
+                    PathProvider path;
+                    path.scan();
+                    path.addTo(db);
+                }));
+            }
+            report(std::string("\"stage\": \"pathStartup\", \"cache\": \"") + scenario + "\"", files.size(), 0, ms);
+        }
+        fs::remove_all(tmp);
+    }
+}
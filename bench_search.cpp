@@ -0,0 +1,162 @@
+// Replays typed queries against AppDB::search over synthetic catalogs of increasing size and
+// reports per-keystroke latency and allocations, one JSON object per catalog.
+//   bench_search [size...]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "AppDB.hpp"
+
+// Counted here rather than through AllocCount so release builds still report allocations
+static size_t allocs = 0;
+
+void* operator new(std::size_t size) {
+    allocs++;
+    if (auto ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+static const char* const syllables[] = {"ka", "lo", "ne", "tri", "um", "gra", "fox", "vim", "pa", "ter", "ix", "sh",
+                                        "ed", "io", "net", "ser", "ve", "lib", "do", "qu", "ar", "mo", "cal", "x"};
+static const char* const words[]     = {"Web", "Browser", "Editor", "Viewer", "Manager", "Settings", "Terminal", "Player",
+                                        "Image", "Text", "Files", "Monitor", "Mail", "Office", "Document", "Music"};
+
+static std::string syllableWord(std::mt19937& rng, int count) {
+    std::string word;
+    for (int i = 0; i < count; i++)
+        word += syllables[rng() % std::size(syllables)];
+    return word;
+}
+
+// Roughly what PATH and a desktop with a few hundred packages look like: short lowercase
+// executables with the odd dash, digit or dot, and a minority of "Name Words" desktop entries
+static std::string appName(std::mt19937& rng, App::Kind kind) {
+    std::uniform_int_distribution<int> parts(1, 3), sylls(1, 4);
+
+    std::string name;
+    if (kind == App::Kind::Desktop) {
+        auto first = syllableWord(rng, sylls(rng));
+        first[0]   = char(first[0] - 'a' + 'A');
+        name       = first;
+        for (int i = parts(rng) - 1; i > 0; i--)
+            name += std::string(" ") + words[rng() % std::size(words)];
+        return name;
+    }
+
+    for (int i = parts(rng); i > 0; i--) {
+        if (!name.empty())
+            name += "-._"[rng() % 3];
+        name += syllableWord(rng, sylls(rng));
+    }
+    if (rng() % 4 == 0)
+        name += std::to_string(rng() % 20);
+    return name;
+}
+
+static void fillCatalog(AppDB& db, size_t size, std::mt19937& rng) {
+    // Names repeat at this size; keep adding until there are enough distinct ones
+    while (db.numApps() < size) {
+        auto kind = rng() % 10 == 0 ? App::Kind::Desktop : App::Kind::Executable;
+        App  app;
+        app.kind = kind;
+        auto name = appName(rng, kind);
+        app.exec  = name;
+        db.add(name, std::move(app));
+    }
+}
+
+// Each step is the full query after one keystroke
+static std::vector<std::string> querySteps(const std::vector<std::string>& names, std::mt19937& rng) {
+    std::vector<std::string> steps;
+    auto                     type = [&](std::string& query, const std::string& text) {
+        for (char c : text) {
+            query += c;
+            steps.push_back(query);
+        }
+    };
+    auto erase = [&](std::string& query, size_t count) {
+        for (; count && !query.empty(); count--) {
+            query.pop_back();
+            steps.push_back(query);
+        }
+    };
+
+    for (int i = 0; i < 40; i++) {
+        const auto& target = names[rng() % names.size()];
+        std::string query;
+
+        // Typing the start of a name, fixing a typo, then carrying on
+        size_t typed = std::min<size_t>(target.size(), 3 + rng() % 5);
+        type(query, target.substr(0, typed));
+        if (i % 3 == 0) {
+            type(query, "zq");
+            erase(query, 2);
+        }
+        type(query, target.substr(typed, 3));
+
+        // Backspacing most of the way and retyping something else
+        erase(query, query.size() - 1);
+        type(query, syllableWord(rng, 2));
+        erase(query, query.size());
+    }
+    return steps;
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    return sorted[std::min(sorted.size() - 1, size_t(p * sorted.size()))];
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; i++)
+        sizes.push_back(std::stoul(argv[i]));
+    if (sizes.empty())
+        sizes = {1000, 10000, 100000, 1000000};
+
+    for (auto size : sizes) {
+        std::mt19937 rng(size);
+        AppDB        db;
+        fillCatalog(db, size, rng);
+
+        std::vector<std::string> names;
+        for (auto& app : static_cast<const AppList&>(db))
+            names.push_back(app.first);
+        auto steps = querySteps(names, rng);
+
+        std::vector<AppList::const_pointer> results;
+        auto                                start = std::chrono::steady_clock::now();
+        db.search("", results); // Builds the index, which a real session pays once per reload
+        double indexMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::vector<double> latencies;
+        latencies.reserve(steps.size());
+        size_t totalAllocs = 0, maxAllocs = 0, totalResults = 0;
+        for (auto& query : steps) {
+            size_t before = allocs;
+            auto   t      = std::chrono::steady_clock::now();
+            db.search(query, results);
+            latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t).count());
+
+            size_t made = allocs - before;
+            totalAllocs += made;
+            maxAllocs = std::max(maxAllocs, made);
+            totalResults += results.size();
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        std::cout << "{\"catalog\": " << size << ", \"keystrokes\": " << steps.size() << ", \"index_ms\": " << indexMs
+                  << ", \"p50_us\": " << percentile(latencies, 0.5) << ", \"p99_us\": " << percentile(latencies, 0.99)
+                  << ", \"max_us\": " << latencies.back() << ", \"allocs_per_query\": " << double(totalAllocs) / steps.size()
+                  << ", \"max_allocs\": " << maxAllocs << ", \"mean_results\": " << double(totalResults) / steps.size() << "}\n";
+    }
+}
@@ -14,19 +14,28 @@
 
 #include <csignal>
 
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
 using namespace std::chrono_literals;
 
 #include <SDL2/SDL.h>
 
+#include "AllocCount.hpp"
 #include "AppDB.hpp"
+#include "ControlServer.hpp"
+#include "EventLoop.hpp"
+#include "History.hpp"
+#include "IconAtlas.hpp"
+#include "IconResolver.hpp"
+#include "Launcher.hpp"
+#include "PathProvider.hpp"
 #include "Picker.hpp"
+#include "Prefetcher.hpp"
 
-static auto snappiness = 16.0ms;
-bool shown             = true;
-void openSignalHandler(int sigNum) { 
-    if(sigNum == SIGUSR1) // Never hurts to be sure
-        shown = !shown; 
-}
+bool shown = true;
 
 
 void loadDefaultPaths(AppDB& db) {
@@ -35,52 +44,253 @@ void loadDefaultPaths(AppDB& db) {
 }
 
 bool shouldReload = true;
-void reloadSignalHandler(int sigNum) {
-    if(sigNum == SIGUSR2)
-        shouldReload = true;
-}
 
+// VOLUND_BENCH_FRAMES=n: once the first frame is up, redraw it n times as fast as they'll go,
+// report and quit. Set VOLUND_VSYNC=0 too, or the frame times are just the refresh rate.
+static void bench(Picker& picker, int frames, std::chrono::steady_clock::time_point started) {
+    using namespace std::chrono;
+    picker.update();
+    auto firstFrame = duration_cast<microseconds>(steady_clock::now() - started).count();
 
+    uint64_t total = 0, worst = 0;
+    for (int i = 0; i < frames; i++) {
+        auto start = steady_clock::now();
+        picker.repaint();
+        picker.update();
+        uint64_t us = duration_cast<microseconds>(steady_clock::now() - start).count();
+        total += us;
+        worst = std::max(worst, us);
+    }
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::cout << "backend: " << Picker::backendNames[int(picker.backend)] << "\npicker init: " << picker.initUs
+              << "us\nfirst frame: " << firstFrame << "us after start\nframes: " << frames << ", mean "
+              << (frames ? total / frames : 0) << "us, max " << worst << "us\npeak rss: " << usage.ru_maxrss << " KiB\n";
+    if (alloccount::enabled)
+        std::cout << "steady frame allocations: " << picker.allocStats.layout << " in layout, " << picker.allocStats.render
+                  << " in render over " << picker.allocStats.steadyFrames << " frames\n";
+}
 
 int main() {
-    auto newSnappiness = std::getenv("VOLUND_SNAPPINESS");
-    if(newSnappiness) {
-      snappiness = std::chrono::duration<long double, std::milli>(std::stof(newSnappiness));
-     std::cerr << "Read snappiness from VOLUND_SNAPPINESS as " << snappiness.count() << std::endl;
-    } else {
-      std::cerr << "$VOLUND_SNAPPINESS was not set. Defaulting to " << snappiness.count() << std::endl;
-    }
+    auto started = std::chrono::steady_clock::now();
+    int  benchFrames = std::getenv("VOLUND_BENCH_FRAMES") ? atoi(std::getenv("VOLUND_BENCH_FRAMES")) : -1;
 
-    signal(SIGUSR1, openSignalHandler);
-    signal(SIGUSR2, reloadSignalHandler);
+    if (std::getenv("VOLUND_SNAPPINESS"))
+        std::cerr << "$VOLUND_SNAPPINESS is no longer used; volund now wakes up as soon as it's signalled\n";
+
+    // First, while we're still small and single threaded: the zygote is a fork of us as we are now
+    Launcher launcher;
+
+    // Blocked before any thread exists so every thread inherits the mask and the signals only
+    // ever arrive through the signalfd
+    sigset_t sigs;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGUSR1);
+    sigaddset(&sigs, SIGUSR2);
+    sigaddset(&sigs, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &sigs, nullptr);
+    int sigFd = signalfd(-1, &sigs, SFD_NONBLOCK | SFD_CLOEXEC);
 
     SDL_Init(SDL_INIT_EVENTS);
 
+    EventLoop loop;
+    launcher.watchReplies(loop);
+    loop.watch(sigFd, [&] {
+        signalfd_siginfo info;
+        while (read(sigFd, &info, sizeof(info)) == sizeof(info)) {
+            if (info.ssi_signo == SIGUSR1)
+                shown = !shown;
+            else if (info.ssi_signo == SIGUSR2)
+                shouldReload = true;
+            else if (info.ssi_signo == SIGCHLD)
+                Launcher::reapChildren();
+        }
+    });
+
     bool running = true;
 
     AppDB db;
+    if (std::getenv("VOLUND_NO_URING"))
+        db.loadMethod = LoadMethod::Stream;
     
-    
+
+    // The resolver's worker feeds the atlas until ~IconResolver joins it, so the atlas has to outlive it
+    IconAtlas    iconAtlas;
+    IconResolver icons;
+    icons.onResolved = [&](auto paths) { iconAtlas.request(std::move(paths)); };
+    iconAtlas.onPublished = [&] { loop.wake(); };
+
+    std::unique_ptr<PathProvider> pathApps;
+    if (!std::getenv("VOLUND_NO_PATH")) {
+        pathApps = std::make_unique<PathProvider>();
+        loop.watch(pathApps->watchFd(), [&] {
+            if (pathApps->changed())
+                shouldReload = true;
+        });
+    }
 
     std::vector<const std::string*> topTen;
 
+    std::unique_ptr<Prefetcher> prefetcher;
+    if (!std::getenv("VOLUND_NO_PREFETCH"))
+        prefetcher = std::make_unique<Prefetcher>();
+    History history;
+    auto    makePicker = [&] {
+        auto picker        = std::make_unique<Picker>(db, launcher, &iconAtlas, &loop);
+        picker->onLaunched = [&](const std::string& name) { history.record(name); };
+        if (prefetcher)
+            picker->onTopResult = [&](const App* app) { prefetcher->candidate(app); };
+        return picker;
+    };
+
+    // While hidden and the machine is idle, keep the most used apps in the page cache: first
+    // shortly after startup (i.e. login), then every few minutes in case memory pressure evicted them
+    unsigned warmApps  = std::getenv("VOLUND_WARM_APPS") ? atoi(std::getenv("VOLUND_WARM_APPS")) : 10;
+    uint64_t warmBytes = uint64_t(std::getenv("VOLUND_WARM_BUDGET_MB") ? atoi(std::getenv("VOLUND_WARM_BUDGET_MB")) : 256) << 20;
+    int      warmFd    = -1;
+    if (prefetcher && warmApps) {
+        int           period = std::getenv("VOLUND_WARM_INTERVAL_S") ? std::max(1, atoi(std::getenv("VOLUND_WARM_INTERVAL_S"))) : 300;
+        itimerspec    spec   = {{period, 0}, {30, 0}};
+        warmFd               = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        timerfd_settime(warmFd, 0, &spec, nullptr);
+        loop.watch(warmFd, [&] {
+            uint64_t expirations;
+            (void)!read(warmFd, &expirations, sizeof(expirations));
+            if (shown || !Prefetcher::systemIdle())
+                return;
+
+            // Every successful launch should have gone through onLaunched; if not, there's nothing to warm
+            unsigned launched = launcher.stats.launches - launcher.stats.failures;
+            if (history.recorded < launched)
+                std::cerr << "Only " << history.recorded << " of " << launched << " launches were recorded in the history\n";
+
+            const AppList&   apps = db;
+            std::vector<App> top;
+            for (auto& name : history.top(warmApps)) {
+                auto app = apps.find(name);
+                if (app != apps.end())
+                    top.push_back(app->second);
+            }
+            prefetcher->warm(std::move(top), warmBytes);
+        });
+    }
+
+    // Window, GL context and font atlas are built once and kept warm, so showing is just a map + one frame.
+    // VOLUND_TRANSIENT brings back building and tearing it all down on every toggle.
+    std::unique_ptr<Picker> persistent;
+    if (!std::getenv("VOLUND_TRANSIENT"))
+        persistent = makePicker();
+
+    Picker*     activePicker = nullptr;
+    std::string showQuery;
+
+    ControlServer control{loop, [&](volund_op op, const std::string& payload, volund_status& status) -> std::string {
+        std::stringstream out;
+        switch (op) {
+        case VOLUND_OP_TOGGLE:
+            shown = !shown;
+            break;
+        case VOLUND_OP_SHOW:
+            shown     = true;
+            showQuery = payload;
+            if (activePicker)
+                activePicker->setQuery(payload);
+            break;
+        case VOLUND_OP_RELOAD:
+            shouldReload = true;
+            break;
+        case VOLUND_OP_STATS: {
+            unsigned desktop = 0;
+            for (auto& app : static_cast<const AppList&>(db)) desktop += app.second.kind == App::Kind::Desktop;
+            out << "apps: " << db.numApps() << "\ndesktop: " << desktop << "\nexecutables: " << db.numApps() - desktop
+                << "\nshown: " << shown << '\n';
+            if (auto atlas = iconAtlas.latest())
+                out << "icon atlas: " << atlas->cells.size() << " icons, " << atlas->width << 'x' << atlas->height << '\n';
+            out << "launcher: " << (launcher.usingZygote() ? "zygote" : "direct") << "\nlaunches: " << launcher.stats.launches
+                << "\nlaunch failures: " << launcher.stats.failures << "\nlaunches recorded in history: " << history.recorded << '\n';
+            if (launcher.stats.launches)
+                out << "launch latency: last " << launcher.stats.lastUs << "us, mean " << launcher.stats.totalUs / launcher.stats.launches
+                    << "us, max " << launcher.stats.maxUs << "us\n";
+            if (auto picker = activePicker ? activePicker : persistent.get(); picker && picker->frames) {
+                out << "frames: " << picker->frames << "\nframes unchanged, not drawn: " << picker->skippedFrames
+                    << "\nsearches over budget: " << picker->searchesOverBudget << '\n';
+                for (int stage = 0; stage < Picker::NumStages; stage++)
+                    out << "frame " << Picker::stageNames[stage] << ": last " << picker->lastFrame.us[stage] << "us, worst "
+                        << picker->worstFrame.us[stage] << "us\n";
+                auto mem = picker->memoryStats();
+                out << "ui arena: " << mem.arenaHighWater << " of " << mem.arenaSize << " bytes at most, grown " << mem.arenaGrowths
+                    << " times\ndraw commands: " << mem.cmdsHighWater << " of " << mem.cmdsSize << " bytes at most\n";
+                out << "frames replaced before drawn: " << picker->droppedFrames() << '\n';
+                if (alloccount::enabled)
+                    out << "steady frame allocations: " << picker->allocStats.layout << " in layout, " << picker->allocStats.render
+                        << " in render over " << picker->allocStats.steadyFrames << " frames\n";
+            }
+            if (prefetcher) {
+                auto prefetched = prefetcher->stats();
+                out << "prefetches: " << prefetched.prefetches << "\nprefetched: " << prefetched.files << " files, "
+                    << prefetched.bytes / 1024 << " KiB\nwarm-ups: " << prefetched.warms << "\nwarmed: " << prefetched.warmedFiles
+                    << " files, " << prefetched.warmedBytes / 1024 << " KiB\n";
+            }
+            break;
+        }
+        case VOLUND_OP_QUERY: {
+            std::vector<AppList::const_pointer> results;
+            db.search(payload, results);
+            for (auto app : results) out << app->first << '\t' << app->second.exec << '\n';
+            break;
+        }
+        default:
+            status = VOLUND_STATUS_ERROR;
+            return "unknown op\n";
+        }
+        return out.str();
+    }};
+
     while (running) {
         if(shouldReload) {
             std::cerr << "Reloading paths...\n";
             shouldReload = false;
             db.clear();
             loadDefaultPaths(db);
+            if (pathApps) {
+                pathApps->scan();
+                pathApps->addTo(db);
+            }
             std::cerr << "Found " << db.numApps() << " apps!\n";
+
+            std::vector<std::string> iconNames;
+            for (auto& app : static_cast<const AppList&>(db))
+                if (!app.second.icon.empty())
+                    iconNames.push_back(app.second.icon);
+            icons.request(std::move(iconNames));
         }
 
         if (!shown)
-            std::this_thread::sleep_for(snappiness);
+            loop.runOnce(-1);
         else {
-            Picker picker{db};
+            if (prefetcher)
+                prefetcher->stopWarming();
+            icons.refresh();
+
+            std::unique_ptr<Picker> transient;
+            if (!persistent)
+                transient = makePicker();
+            auto& picker = persistent ? *persistent : *transient;
 
+            picker.show(showQuery);
+            showQuery.clear();
+            activePicker = &picker;
+            if (benchFrames >= 0) {
+                bench(picker, benchFrames, started);
+                running = false;
+            }
             while (running && shown) picker.update();
+            activePicker = nullptr;
+            picker.hide();
         }
     }
+    persistent.reset();
     SDL_Quit();
     return 0;
 }
@@ -16,14 +16,65 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_opengl.h>
 
-NK_API struct nk_context*   nk_sdl_init(SDL_Window *win);
+/* Where the context (without memory), the command buffer and frame buffers get their heap memory
+ * from; malloc by default. Set before nk_sdl_init and nk_sdl_frame_init, since both keep a copy. */
+NK_API void                 nk_sdl_set_allocator(const struct nk_allocator *alloc);
+/* With memory, the context runs on that fixed arena (nk_init_fixed) instead of malloc */
+NK_API struct nk_context*   nk_sdl_init(SDL_Window *win, void *memory, nk_size size);
 NK_API void                 nk_sdl_font_stash_begin(struct nk_font_atlas **atlas);
 NK_API void                 nk_sdl_font_stash_end(void);
+
+/* Everything a baked single-font atlas boils down to. Pointers are borrowed: from the atlas
+ * while nk_sdl_font_stash_end_with's callback runs, or from wherever a restored one came from. */
+struct nk_sdl_baked_font {
+    int tex_width, tex_height; /* RGBA32 */
+    const void *pixels;
+    float size;
+    nk_rune fallback;
+    float height, ascent, descent;
+    struct nk_recti custom;
+    struct nk_cursor cursors[NK_CURSOR_COUNT];
+    int glyph_count;
+    const struct nk_font_glyph *glyphs;
+    int sdf_spread; /* 0 for a plain coverage atlas */
+};
+/* Like nk_sdl_font_stash_end, but hands the bake to `baked` first. Only called for an atlas of
+ * a single font with the default glyph ranges, which is all nk_sdl_font_stash_restore handles. */
+NK_API void                 nk_sdl_font_stash_end_with(void (*baked)(const struct nk_sdl_baked_font*, void*), void *userdata);
+/* Sets up the atlas, font texture and style font from an earlier bake instead of baking */
+NK_API int                  nk_sdl_font_stash_restore(const struct nk_sdl_baked_font *baked);
 NK_API int                  nk_sdl_handle_event(SDL_Event *evt);
+/* The buffer sizes are only starting points; the buffers grow to whatever a frame needs */
 NK_API void                 nk_sdl_render(enum nk_anti_aliasing , int max_vertex_buffer, int max_element_buffer);
 NK_API void                 nk_sdl_shutdown(void);
 NK_API void                 nk_sdl_device_destroy(void);
 NK_API void                 nk_sdl_device_create(void);
+NK_API void                 nk_sdl_set_icon_texture(GLuint tex);
+/* Non-zero: bakes from here on turn the font atlas into a signed distance field with this
+ * spread in texels, and text is drawn from it with a smoothstep edge, sharp at any scale */
+NK_API void                 nk_sdl_font_sdf(int spread);
+/* Draws the stashed font at this height without rebaking; blurry when scaled up unless SDF */
+NK_API void                 nk_sdl_set_font_height(float height);
+/* nk_convert's draw commands go to a fixed buffer that doubles whenever a frame overflows it */
+NK_API void                 nk_sdl_cmds_usage(nk_size *high_water, nk_size *size);
+
+/* nk_sdl_render split in two, for laying out on one thread and drawing on another that has the
+ * GL context current: nk_sdl_convert makes no GL calls, nk_sdl_render_frame doesn't touch the
+ * nuklear context. A frame's buffers are kept and reused by the next convert into it. */
+struct nk_sdl_draw {
+    nk_uint elem_count;
+    struct nk_rect clip_rect;
+    nk_handle texture;
+};
+struct nk_sdl_frame {
+    struct nk_buffer vbuf, ebuf, draws; /* draws holds struct nk_sdl_draw */
+    int width, height, display_width, display_height;
+};
+NK_API void                 nk_sdl_frame_init(struct nk_sdl_frame *frame);
+NK_API void                 nk_sdl_frame_free(struct nk_sdl_frame *frame);
+/* Converts the context into frame and clears it, like nk_sdl_render minus the drawing */
+NK_API void                 nk_sdl_convert(struct nk_sdl_frame *frame, enum nk_anti_aliasing AA);
+NK_API void                 nk_sdl_render_frame(const struct nk_sdl_frame *frame);
 
 #endif
 
@@ -38,10 +89,17 @@ NK_API void                 nk_sdl_device_create(void);
 
 #include <string.h>
 
+#ifndef NK_SDL_CMDS_SIZE
+#define NK_SDL_CMDS_SIZE (16 * 1024)
+#endif
+
 struct nk_sdl_device {
     struct nk_buffer cmds;
+    void *cmds_memory;
+    nk_size cmds_high_water;
     struct nk_draw_null_texture null;
     GLuint vbo, vao, ebo;
+    GLsizeiptr vbo_size, ebo_size;
     GLuint prog;
     GLuint vert_shdr;
     GLuint frag_shdr;
@@ -51,6 +109,10 @@ struct nk_sdl_device {
     GLint uniform_tex;
     GLint uniform_proj;
     GLuint font_tex;
+    GLuint icon_tex;
+    GLuint white_tex; /* 1x1 null texture for untextured shapes, so the font atlas can be an SDF */
+    GLint uniform_sdf;
+    int sdf_spread;
 };
 
 struct nk_sdl_vertex {
@@ -64,8 +126,42 @@ static struct nk_sdl {
     struct nk_sdl_device ogl;
     struct nk_context ctx;
     struct nk_font_atlas atlas;
+    struct nk_allocator alloc;
 } sdl;
 
+NK_INTERN struct nk_allocator*
+nk_sdl_allocator(void)
+{
+    if (!sdl.alloc.alloc) {
+        sdl.alloc.alloc = nk_malloc;
+        sdl.alloc.free = nk_mfree;
+    }
+    return &sdl.alloc;
+}
+
+NK_API void
+nk_sdl_set_allocator(const struct nk_allocator *alloc)
+{
+    sdl.alloc = *alloc;
+}
+
+NK_INTERN void
+nk_sdl_cmds_resize(struct nk_sdl_device *dev, nk_size size)
+{
+    struct nk_allocator *alloc = nk_sdl_allocator();
+    if (dev->cmds_memory)
+        alloc->free(alloc->userdata, dev->cmds_memory);
+    dev->cmds_memory = alloc->alloc(alloc->userdata, 0, size);
+    nk_buffer_init_fixed(&dev->cmds, dev->cmds_memory, size);
+}
+
+NK_API void
+nk_sdl_cmds_usage(nk_size *high_water, nk_size *size)
+{
+    *high_water = sdl.ogl.cmds_high_water;
+    *size = sdl.ogl.cmds.memory.size;
+}
+
 #ifdef __APPLE__
   #define NK_SHADER_VERSION "#version 150\n"
 #else
@@ -92,15 +188,21 @@ nk_sdl_device_create(void)
         NK_SHADER_VERSION
         "precision mediump float;\n"
         "uniform sampler2D Texture;\n"
+        "uniform int Sdf;\n"
         "in vec2 Frag_UV;\n"
         "in vec4 Frag_Color;\n"
         "out vec4 Out_Color;\n"
         "void main(){\n"
-        "   Out_Color = Frag_Color * texture(Texture, Frag_UV.st);\n"
+        "   vec4 tex = texture(Texture, Frag_UV.st);\n"
+        "   if (Sdf != 0) {\n"
+        "       float w = max(fwidth(tex.a), 0.0001);\n"
+        "       tex = vec4(1.0, 1.0, 1.0, smoothstep(0.5 - w, 0.5 + w, tex.a));\n"
+        "   }\n"
+        "   Out_Color = Frag_Color * tex;\n"
         "}\n";
 
     struct nk_sdl_device *dev = &sdl.ogl;
-    nk_buffer_init_default(&dev->cmds);
+    nk_sdl_cmds_resize(dev, NK_SDL_CMDS_SIZE);
     dev->prog = glCreateProgram();
     dev->vert_shdr = glCreateShader(GL_VERTEX_SHADER);
     dev->frag_shdr = glCreateShader(GL_FRAGMENT_SHADER);
@@ -120,6 +222,7 @@ nk_sdl_device_create(void)
 
     dev->uniform_tex = glGetUniformLocation(dev->prog, "Texture");
     dev->uniform_proj = glGetUniformLocation(dev->prog, "ProjMtx");
+    dev->uniform_sdf = glGetUniformLocation(dev->prog, "Sdf");
     dev->attrib_pos = glGetAttribLocation(dev->prog, "Position");
     dev->attrib_uv = glGetAttribLocation(dev->prog, "TexCoord");
     dev->attrib_col = glGetAttribLocation(dev->prog, "Color");
@@ -148,6 +251,15 @@ nk_sdl_device_create(void)
         glVertexAttribPointer((GLuint)dev->attrib_col, 4, GL_UNSIGNED_BYTE, GL_TRUE, vs, (void*)vc);
     }
 
+    {
+        static const nk_byte white[4] = {255, 255, 255, 255};
+        glGenTextures(1, &dev->white_tex);
+        glBindTexture(GL_TEXTURE_2D, dev->white_tex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    }
+
     glBindTexture(GL_TEXTURE_2D, 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
@@ -166,6 +278,14 @@ nk_sdl_device_upload_atlas(const void *image, int width, int height)
                 GL_RGBA, GL_UNSIGNED_BYTE, image);
 }
 
+/* The icon atlas lives on texture unit 1 for the whole frame so switching between
+ * it and the font atlas is a sampler uniform change rather than a texture bind */
+NK_API void
+nk_sdl_set_icon_texture(GLuint tex)
+{
+    sdl.ogl.icon_tex = tex;
+}
+
 NK_API void
 nk_sdl_device_destroy(void)
 {
@@ -176,31 +296,42 @@ nk_sdl_device_destroy(void)
     glDeleteShader(dev->frag_shdr);
     glDeleteProgram(dev->prog);
     glDeleteTextures(1, &dev->font_tex);
+    glDeleteTextures(1, &dev->white_tex);
     glDeleteBuffers(1, &dev->vbo);
     glDeleteBuffers(1, &dev->ebo);
-    nk_buffer_free(&dev->cmds);
+    if (dev->cmds_memory)
+        sdl.alloc.free(sdl.alloc.userdata, dev->cmds_memory);
+    dev->cmds_memory = 0;
 }
 
-NK_API void
-nk_sdl_render(enum nk_anti_aliasing AA, int max_vertex_buffer, int max_element_buffer)
+/* What the draw calls of one frame have in common, so the state changes between them are skipped
+ * when they'd be no-ops */
+struct nk_sdl_draw_state {
+    struct nk_vec2 scale;
+    int height;
+    const nk_draw_index *offset;
+    GLint unit;
+    GLuint bound;
+    int sdf;
+};
+
+NK_INTERN void
+nk_sdl_draw_begin(struct nk_sdl_draw_state *state, int width, int height, int display_width, int display_height)
 {
     struct nk_sdl_device *dev = &sdl.ogl;
-    int width, height;
-    int display_width, display_height;
-    struct nk_vec2 scale;
     GLfloat ortho[4][4] = {
         {2.0f, 0.0f, 0.0f, 0.0f},
         {0.0f,-2.0f, 0.0f, 0.0f},
         {0.0f, 0.0f,-1.0f, 0.0f},
         {-1.0f,1.0f, 0.0f, 1.0f},
     };
-    SDL_GetWindowSize(sdl.win, &width, &height);
-    SDL_GL_GetDrawableSize(sdl.win, &display_width, &display_height);
     ortho[0][0] /= (GLfloat)width;
     ortho[1][1] /= (GLfloat)height;
 
-    scale.x = (float)display_width/(float)width;
-    scale.y = (float)display_height/(float)height;
+    NK_MEMSET(state, 0, sizeof(*state));
+    state->scale.x = (float)display_width/(float)width;
+    state->scale.y = (float)display_height/(float)height;
+    state->height = height;
 
     /* setup global state */
     glViewport(0,0,display_width,display_height);
@@ -215,67 +346,47 @@ nk_sdl_render(enum nk_anti_aliasing AA, int max_vertex_buffer, int max_element_b
     /* setup program */
     glUseProgram(dev->prog);
     glUniform1i(dev->uniform_tex, 0);
+    glUniform1i(dev->uniform_sdf, 0);
     glUniformMatrix4fv(dev->uniform_proj, 1, GL_FALSE, &ortho[0][0]);
-    {
-        /* convert from command queue into draw list and draw to screen */
-        const struct nk_draw_command *cmd;
-        void *vertices, *elements;
-        const nk_draw_index *offset = NULL;
-        struct nk_buffer vbuf, ebuf;
 
-        /* allocate vertex and element buffer */
-        glBindVertexArray(dev->vao);
-        glBindBuffer(GL_ARRAY_BUFFER, dev->vbo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, dev->ebo);
+    glBindVertexArray(dev->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, dev->vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, dev->ebo);
 
-        glBufferData(GL_ARRAY_BUFFER, max_vertex_buffer, NULL, GL_STREAM_DRAW);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, max_element_buffer, NULL, GL_STREAM_DRAW);
-
-        /* load vertices/elements directly into vertex/element buffer */
-        vertices = glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
-        elements = glMapBuffer(GL_ELEMENT_ARRAY_BUFFER, GL_WRITE_ONLY);
-        {
-            /* fill convert configuration */
-            struct nk_convert_config config;
-            static const struct nk_draw_vertex_layout_element vertex_layout[] = {
-                {NK_VERTEX_POSITION, NK_FORMAT_FLOAT, NK_OFFSETOF(struct nk_sdl_vertex, position)},
-                {NK_VERTEX_TEXCOORD, NK_FORMAT_FLOAT, NK_OFFSETOF(struct nk_sdl_vertex, uv)},
-                {NK_VERTEX_COLOR, NK_FORMAT_R8G8B8A8, NK_OFFSETOF(struct nk_sdl_vertex, col)},
-                {NK_VERTEX_LAYOUT_END}
-            };
-            NK_MEMSET(&config, 0, sizeof(config));
-            config.vertex_layout = vertex_layout;
-            config.vertex_size = sizeof(struct nk_sdl_vertex);
-            config.vertex_alignment = NK_ALIGNOF(struct nk_sdl_vertex);
-            config.null = dev->null;
-            config.circle_segment_count = 22;
-            config.curve_segment_count = 22;
-            config.arc_segment_count = 22;
-            config.global_alpha = 1.0f;
-            config.shape_AA = AA;
-            config.line_AA = AA;
-
-            /* setup buffers to load vertices and elements */
-            nk_buffer_init_fixed(&vbuf, vertices, (nk_size)max_vertex_buffer);
-            nk_buffer_init_fixed(&ebuf, elements, (nk_size)max_element_buffer);
-            nk_convert(&sdl.ctx, &dev->cmds, &vbuf, &ebuf, &config);
-        }
-        glUnmapBuffer(GL_ARRAY_BUFFER);
-        glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, dev->icon_tex);
+    glActiveTexture(GL_TEXTURE0);
+}
 
-        /* iterate over and execute each draw command */
-        nk_draw_foreach(cmd, &sdl.ctx, &dev->cmds) {
-            if (!cmd->elem_count) continue;
-            glBindTexture(GL_TEXTURE_2D, (GLuint)cmd->texture.id);
-            glScissor((GLint)(cmd->clip_rect.x * scale.x),
-                (GLint)((height - (GLint)(cmd->clip_rect.y + cmd->clip_rect.h)) * scale.y),
-                (GLint)(cmd->clip_rect.w * scale.x),
-                (GLint)(cmd->clip_rect.h * scale.y));
-            glDrawElements(GL_TRIANGLES, (GLsizei)cmd->elem_count, GL_UNSIGNED_SHORT, offset);
-            offset += cmd->elem_count;
-        }
-        nk_clear(&sdl.ctx);
+NK_INTERN void
+nk_sdl_draw_elements(struct nk_sdl_draw_state *state, nk_handle texture, struct nk_rect clip, nk_uint elem_count)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    /* Follows NK_UINT_DRAW_INDEX, which is what nk_convert writes */
+    const GLenum index_type = sizeof(nk_draw_index) == 4 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+    if (!elem_count) return;
+    if (dev->sdf_spread && state->sdf != ((GLuint)texture.id == dev->font_tex))
+        glUniform1i(dev->uniform_sdf, state->sdf = !state->sdf);
+    if (dev->icon_tex && (GLuint)texture.id == dev->icon_tex) {
+        if (state->unit != 1) glUniform1i(dev->uniform_tex, state->unit = 1);
+    } else {
+        if (state->unit != 0) glUniform1i(dev->uniform_tex, state->unit = 0);
+        if (state->bound != (GLuint)texture.id) glBindTexture(GL_TEXTURE_2D, state->bound = (GLuint)texture.id);
     }
+    glScissor((GLint)(clip.x * state->scale.x),
+        (GLint)((state->height - (GLint)(clip.y + clip.h)) * state->scale.y),
+        (GLint)(clip.w * state->scale.x),
+        (GLint)(clip.h * state->scale.y));
+    glDrawElements(GL_TRIANGLES, (GLsizei)elem_count, index_type, state->offset);
+    state->offset += elem_count;
+}
+
+NK_INTERN void
+nk_sdl_draw_end(void)
+{
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
 
     glUseProgram(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -285,6 +396,175 @@ nk_sdl_render(enum nk_anti_aliasing AA, int max_vertex_buffer, int max_element_b
     glDisable(GL_SCISSOR_TEST);
 }
 
+NK_INTERN void
+nk_sdl_convert_config(struct nk_convert_config *config, enum nk_anti_aliasing AA)
+{
+    static const struct nk_draw_vertex_layout_element vertex_layout[] = {
+        {NK_VERTEX_POSITION, NK_FORMAT_FLOAT, NK_OFFSETOF(struct nk_sdl_vertex, position)},
+        {NK_VERTEX_TEXCOORD, NK_FORMAT_FLOAT, NK_OFFSETOF(struct nk_sdl_vertex, uv)},
+        {NK_VERTEX_COLOR, NK_FORMAT_R8G8B8A8, NK_OFFSETOF(struct nk_sdl_vertex, col)},
+        {NK_VERTEX_LAYOUT_END}
+    };
+    NK_MEMSET(config, 0, sizeof(*config));
+    config->vertex_layout = vertex_layout;
+    config->vertex_size = sizeof(struct nk_sdl_vertex);
+    config->vertex_alignment = NK_ALIGNOF(struct nk_sdl_vertex);
+    config->null = sdl.ogl.null;
+    config->circle_segment_count = 22;
+    config->curve_segment_count = 22;
+    config->arc_segment_count = 22;
+    config->global_alpha = 1.0f;
+    config->shape_AA = AA;
+    config->line_AA = AA;
+}
+
+NK_API void
+nk_sdl_render(enum nk_anti_aliasing AA, int max_vertex_buffer, int max_element_buffer)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    int width, height;
+    int display_width, display_height;
+    struct nk_sdl_draw_state state;
+    SDL_GetWindowSize(sdl.win, &width, &height);
+    SDL_GL_GetDrawableSize(sdl.win, &display_width, &display_height);
+    nk_sdl_draw_begin(&state, width, height, display_width, display_height);
+    {
+        /* convert from command queue into draw list and draw to screen */
+        const struct nk_draw_command *cmd;
+        void *vertices, *elements;
+        struct nk_buffer vbuf, ebuf;
+        GLsizeiptr vbo_size, ebo_size;
+        struct nk_convert_config config;
+        nk_sdl_convert_config(&config, AA);
+
+        /* The buffers persist across frames and only ever grow, doubling (or straight to what the
+         * last attempt needed) whenever a frame doesn't fit, so they settle at no more than twice
+         * the biggest frame seen. Mapping with INVALIDATE_BUFFER lets the driver hand us fresh
+         * storage while the GPU may still be reading last frame's, without a reallocation. */
+        vbo_size = NK_MAX(dev->vbo_size, (GLsizeiptr)max_vertex_buffer);
+        ebo_size = NK_MAX(dev->ebo_size, (GLsizeiptr)max_element_buffer);
+        for (;;) {
+            nk_flags res;
+            if (vbo_size != dev->vbo_size)
+                glBufferData(GL_ARRAY_BUFFER, dev->vbo_size = vbo_size, NULL, GL_STREAM_DRAW);
+            if (ebo_size != dev->ebo_size)
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, dev->ebo_size = ebo_size, NULL, GL_STREAM_DRAW);
+            vertices = glMapBufferRange(GL_ARRAY_BUFFER, 0, vbo_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            elements = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, ebo_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+            /* load vertices/elements directly into vertex/element buffer */
+            nk_buffer_clear(&dev->cmds);
+            nk_buffer_init_fixed(&vbuf, vertices, (nk_size)vbo_size);
+            nk_buffer_init_fixed(&ebuf, elements, (nk_size)ebo_size);
+            res = nk_convert(&sdl.ctx, &dev->cmds, &vbuf, &ebuf, &config);
+
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+            if (!(res & (NK_CONVERT_VERTEX_BUFFER_FULL | NK_CONVERT_ELEMENT_BUFFER_FULL | NK_CONVERT_COMMAND_BUFFER_FULL)))
+                break;
+            if (res & NK_CONVERT_COMMAND_BUFFER_FULL)
+                nk_sdl_cmds_resize(dev, NK_MAX(dev->cmds.memory.size * 2, NK_SDL_CMDS_SIZE));
+            if (res & NK_CONVERT_VERTEX_BUFFER_FULL)
+                vbo_size = NK_MAX(vbo_size * 2, (GLsizeiptr)vbuf.needed);
+            if (res & NK_CONVERT_ELEMENT_BUFFER_FULL)
+                ebo_size = NK_MAX(ebo_size * 2, (GLsizeiptr)ebuf.needed);
+        }
+
+        /* Draw commands are pushed onto the back of the buffer */
+        dev->cmds_high_water = NK_MAX(dev->cmds_high_water, dev->cmds.memory.size - dev->cmds.size);
+
+        /* iterate over and execute each draw command */
+        nk_draw_foreach(cmd, &sdl.ctx, &dev->cmds)
+            nk_sdl_draw_elements(&state, cmd->texture, cmd->clip_rect, cmd->elem_count);
+        nk_clear(&sdl.ctx);
+    }
+    nk_sdl_draw_end();
+}
+
+NK_API void
+nk_sdl_frame_init(struct nk_sdl_frame *frame)
+{
+    struct nk_allocator *alloc = nk_sdl_allocator();
+    NK_MEMSET(frame, 0, sizeof(*frame));
+    nk_buffer_init(&frame->vbuf, alloc, NK_BUFFER_DEFAULT_INITIAL_SIZE);
+    nk_buffer_init(&frame->ebuf, alloc, NK_BUFFER_DEFAULT_INITIAL_SIZE);
+    nk_buffer_init(&frame->draws, alloc, NK_BUFFER_DEFAULT_INITIAL_SIZE);
+}
+
+NK_API void
+nk_sdl_frame_free(struct nk_sdl_frame *frame)
+{
+    nk_buffer_free(&frame->vbuf);
+    nk_buffer_free(&frame->ebuf);
+    nk_buffer_free(&frame->draws);
+}
+
+NK_API void
+nk_sdl_convert(struct nk_sdl_frame *frame, enum nk_anti_aliasing AA)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    const struct nk_draw_command *cmd;
+    struct nk_convert_config config;
+    nk_sdl_convert_config(&config, AA);
+
+    SDL_GetWindowSize(sdl.win, &frame->width, &frame->height);
+    SDL_GL_GetDrawableSize(sdl.win, &frame->display_width, &frame->display_height);
+
+    /* The vertex and element buffers grow on their own; only the fixed command buffer can fill */
+    for (;;) {
+        nk_buffer_clear(&dev->cmds);
+        nk_buffer_clear(&frame->vbuf);
+        nk_buffer_clear(&frame->ebuf);
+        if (!(nk_convert(&sdl.ctx, &dev->cmds, &frame->vbuf, &frame->ebuf, &config) & NK_CONVERT_COMMAND_BUFFER_FULL))
+            break;
+        nk_sdl_cmds_resize(dev, NK_MAX(dev->cmds.memory.size * 2, NK_SDL_CMDS_SIZE));
+    }
+    dev->cmds_high_water = NK_MAX(dev->cmds_high_water, dev->cmds.memory.size - dev->cmds.size);
+
+    /* nk_draw_foreach needs the context's draw list, which the next convert starts over */
+    nk_buffer_clear(&frame->draws);
+    nk_draw_foreach(cmd, &sdl.ctx, &dev->cmds) {
+        struct nk_sdl_draw *draw = (struct nk_sdl_draw*)nk_buffer_alloc(&frame->draws,
+            NK_BUFFER_FRONT, sizeof(struct nk_sdl_draw), NK_ALIGNOF(struct nk_sdl_draw));
+        if (!draw) break;
+        draw->elem_count = cmd->elem_count;
+        draw->clip_rect = cmd->clip_rect;
+        draw->texture = cmd->texture;
+    }
+    nk_clear(&sdl.ctx);
+}
+
+NK_API void
+nk_sdl_render_frame(const struct nk_sdl_frame *frame)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    struct nk_sdl_draw_state state;
+    const struct nk_sdl_draw *draw = (const struct nk_sdl_draw*)nk_buffer_memory_const(&frame->draws);
+    nk_size i, count = frame->draws.allocated / sizeof(struct nk_sdl_draw);
+    GLsizeiptr vbo_size = (GLsizeiptr)frame->vbuf.allocated, ebo_size = (GLsizeiptr)frame->ebuf.allocated;
+    void *mapped;
+
+    nk_sdl_draw_begin(&state, frame->width, frame->height, frame->display_width, frame->display_height);
+
+    /* Same growth and INVALIDATE_BUFFER mapping as nk_sdl_render, only copied rather than converted in */
+    if (vbo_size > dev->vbo_size)
+        glBufferData(GL_ARRAY_BUFFER, dev->vbo_size = NK_MAX(dev->vbo_size * 2, vbo_size), NULL, GL_STREAM_DRAW);
+    if (ebo_size > dev->ebo_size)
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, dev->ebo_size = NK_MAX(dev->ebo_size * 2, ebo_size), NULL, GL_STREAM_DRAW);
+    if (vbo_size && (mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, dev->vbo_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT))) {
+        NK_MEMCPY(mapped, nk_buffer_memory_const(&frame->vbuf), (nk_size)vbo_size);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    if (ebo_size && (mapped = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, dev->ebo_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT))) {
+        NK_MEMCPY(mapped, nk_buffer_memory_const(&frame->ebuf), (nk_size)ebo_size);
+        glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+    }
+
+    for (i = 0; i < count; ++i)
+        nk_sdl_draw_elements(&state, draw[i].texture, draw[i].clip_rect, draw[i].elem_count);
+    nk_sdl_draw_end();
+}
+
 static void
 nk_sdl_clipboard_paste(nk_handle usr, struct nk_text_edit *edit)
 {
@@ -308,10 +588,12 @@ nk_sdl_clipboard_copy(nk_handle usr, const char *text, int len)
 }
 
 NK_API struct nk_context*
-nk_sdl_init(SDL_Window *win)
+nk_sdl_init(SDL_Window *win, void *memory, nk_size size)
 {
     sdl.win = win;
-    nk_init_default(&sdl.ctx, 0);
+    if (memory)
+        nk_init_fixed(&sdl.ctx, memory, size, 0);
+    else nk_init(&sdl.ctx, nk_sdl_allocator(), 0);
     sdl.ctx.clip.copy = nk_sdl_clipboard_copy;
     sdl.ctx.clip.paste = nk_sdl_clipboard_paste;
     sdl.ctx.clip.userdata = nk_handle_ptr(0);
@@ -327,16 +609,165 @@ nk_sdl_font_stash_begin(struct nk_font_atlas **atlas)
     *atlas = &sdl.atlas;
 }
 
+NK_API void
+nk_sdl_font_sdf(int spread)
+{
+    sdl.ogl.sdf_spread = spread > 0 ? spread : 0;
+}
+
+/* Replaces the coverage in each glyph's rect with its distance to the outline, 0.5 on the
+ * edge and 0/1 at spread texels out/in. Brute force, but it only runs when the atlas cache misses. */
+NK_INTERN void
+nk_sdl_font_make_sdf(nk_byte *pixels, int w, int h, int spread)
+{
+    struct nk_font_atlas *atlas = &sdl.atlas;
+    nk_byte *inside;
+    int i, x, y;
+
+    inside = (nk_byte*)atlas->temporary.alloc(atlas->temporary.userdata, 0, (nk_size)w * (nk_size)h);
+    if (!inside) return;
+    for (i = 0; i < w * h; ++i)
+        inside[i] = pixels[i * 4 + 3] >= 128;
+
+    for (i = 0; i < atlas->glyph_count; ++i) {
+        const struct nk_font_glyph *g = &atlas->glyphs[i];
+        int x0 = (int)(g->u0 * (float)w + 0.5f), x1 = (int)(g->u1 * (float)w + 0.5f);
+        int y0 = (int)(g->v0 * (float)h + 0.5f), y1 = (int)(g->v1 * (float)h + 0.5f);
+        for (y = y0; y < y1; ++y) {
+            for (x = x0; x < x1; ++x) {
+                int in = inside[y * w + x], best = spread * spread + 1, dx, dy;
+                float d;
+                /* Past the rect counts as outside, it's some other glyph's (or nothing's) texels */
+                for (dy = -spread; dy <= spread; ++dy) {
+                    for (dx = -spread; dx <= spread; ++dx) {
+                        int ny = y + dy, nx = x + dx;
+                        int other = ny >= y0 && ny < y1 && nx >= x0 && nx < x1 && inside[ny * w + nx];
+                        if (other != in && dx * dx + dy * dy < best)
+                            best = dx * dx + dy * dy;
+                    }
+                }
+                /* The edge runs between the two texels, half a texel short of the nearest one */
+                d = NK_CLAMP(0.0f, nk_sqrt((float)best) - 0.5f, (float)spread);
+                d = 0.5f + (in ? d : -d) / (float)(2 * spread);
+                pixels[(y * w + x) * 4 + 3] = (nk_byte)(d * 255.0f + 0.5f);
+            }
+        }
+    }
+    atlas->temporary.free(atlas->temporary.userdata, inside);
+}
+
+NK_INTERN void
+nk_sdl_font_finish(const void *image, int w, int h)
+{
+    nk_sdl_device_upload_atlas(image, w, h);
+    nk_font_atlas_end(&sdl.atlas, nk_handle_id((int)sdl.ogl.font_tex), &sdl.ogl.null);
+    if (sdl.ogl.sdf_spread) {
+        /* Solid shapes would otherwise sample the atlas' white rect, which is no longer white */
+        sdl.ogl.null.texture = nk_handle_id((int)sdl.ogl.white_tex);
+        sdl.ogl.null.uv = nk_vec2(0.5f, 0.5f);
+    }
+}
+
+NK_API void
+nk_sdl_set_font_height(float height)
+{
+    if (!sdl.atlas.default_font) return;
+    sdl.atlas.default_font->handle.height = height;
+    nk_style_set_font(&sdl.ctx, &sdl.atlas.default_font->handle);
+}
+
 NK_API void
 nk_sdl_font_stash_end(void)
+{
+    nk_sdl_font_stash_end_with(NULL, NULL);
+}
+
+NK_API void
+nk_sdl_font_stash_end_with(void (*baked)(const struct nk_sdl_baked_font*, void*), void *userdata)
 {
     const void *image; int w, h;
+    struct nk_font *font;
     image = nk_font_atlas_bake(&sdl.atlas, &w, &h, NK_FONT_ATLAS_RGBA32);
-    nk_sdl_device_upload_atlas(image, w, h);
-    nk_font_atlas_end(&sdl.atlas, nk_handle_id((int)sdl.ogl.font_tex), &sdl.ogl.null);
+    font = sdl.atlas.fonts;
+    if (image && sdl.ogl.sdf_spread)
+        nk_sdl_font_make_sdf((nk_byte*)image, w, h, sdl.ogl.sdf_spread);
+    if (baked && image && sdl.atlas.font_num == 1 && font->config->n == font->config &&
+        font->config->range == nk_font_default_glyph_ranges()) {
+        struct nk_sdl_baked_font out;
+        NK_MEMSET(&out, 0, sizeof(out));
+        out.tex_width = w;
+        out.tex_height = h;
+        out.pixels = image;
+        out.size = font->config->size;
+        out.fallback = font->fallback_codepoint;
+        out.height = font->info.height;
+        out.ascent = font->info.ascent;
+        out.descent = font->info.descent;
+        out.custom = sdl.atlas.custom;
+        NK_MEMCPY(out.cursors, sdl.atlas.cursors, sizeof(out.cursors));
+        out.glyph_count = sdl.atlas.glyph_count;
+        out.glyphs = sdl.atlas.glyphs;
+        out.sdf_spread = sdl.ogl.sdf_spread;
+        baked(&out, userdata);
+    }
+    nk_sdl_font_finish(image, w, h);
     if (sdl.atlas.default_font)
         nk_style_set_font(&sdl.ctx, &sdl.atlas.default_font->handle);
+}
+
+/* Rebuilds what nk_font_atlas_add + nk_font_atlas_bake would have left behind, allocated the
+ * same way, so nk_font_atlas_clear frees it like any other atlas */
+NK_API int
+nk_sdl_font_stash_restore(const struct nk_sdl_baked_font *baked)
+{
+    struct nk_font_atlas *atlas = &sdl.atlas;
+    struct nk_font_config *cfg;
+    struct nk_font *font;
+    struct nk_baked_font info;
+
+    nk_font_atlas_init_default(atlas);
+    nk_font_atlas_begin(atlas);
+    cfg = (struct nk_font_config*)atlas->permanent.alloc(atlas->permanent.userdata, 0, sizeof(*cfg));
+    font = (struct nk_font*)atlas->permanent.alloc(atlas->permanent.userdata, 0, sizeof(*font));
+    atlas->glyphs = (struct nk_font_glyph*)atlas->permanent.alloc(atlas->permanent.userdata, 0,
+        sizeof(struct nk_font_glyph) * (nk_size)baked->glyph_count);
+    if (!cfg || !font || !atlas->glyphs) {
+        if (cfg) atlas->permanent.free(atlas->permanent.userdata, cfg);
+        if (font) atlas->permanent.free(atlas->permanent.userdata, font);
+        if (atlas->glyphs) atlas->permanent.free(atlas->permanent.userdata, atlas->glyphs);
+        nk_zero_struct(*atlas);
+        return 0;
+    }
 
+    *cfg = nk_font_config(baked->size);
+    cfg->n = cfg->p = cfg;
+    cfg->fallback_glyph = baked->fallback;
+    cfg->font = &font->info;
+    NK_MEMSET(font, 0, sizeof(*font));
+    font->config = cfg;
+    atlas->config = cfg;
+    atlas->fonts = atlas->default_font = font;
+    atlas->font_num = 1;
+
+    atlas->glyph_count = baked->glyph_count;
+    NK_MEMCPY(atlas->glyphs, baked->glyphs, sizeof(struct nk_font_glyph) * (nk_size)baked->glyph_count);
+    info.height = baked->height;
+    info.ascent = baked->ascent;
+    info.descent = baked->descent;
+    info.glyph_offset = 0;
+    info.glyph_count = (nk_rune)baked->glyph_count;
+    info.ranges = cfg->range;
+    nk_font_init(font, baked->size, baked->fallback, atlas->glyphs, &info, nk_handle_ptr(0));
+
+    atlas->custom = baked->custom;
+    atlas->tex_width = baked->tex_width;
+    atlas->tex_height = baked->tex_height;
+    NK_MEMCPY(atlas->cursors, baked->cursors, sizeof(atlas->cursors));
+
+    sdl.ogl.sdf_spread = baked->sdf_spread;
+    nk_sdl_font_finish(baked->pixels, baked->tex_width, baked->tex_height);
+    nk_style_set_font(&sdl.ctx, &font->handle);
+    return 1;
 }
 
 NK_API int
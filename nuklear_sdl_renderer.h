@@ -0,0 +1,353 @@
+/*
+ * Nuklear - 1.32.0 - public domain
+ * no warrenty implied; use at your own risk.
+ * authored from 2015-2016 by Micha Mettke
+ */
+/*
+ * ==============================================================
+ *
+ *                              API
+ *
+ * ===============================================================
+ */
+#ifndef NK_SDL_RENDERER_H_
+#define NK_SDL_RENDERER_H_
+
+/* Same job as nuklear_sdl_gl3.h, drawn through SDL_RenderGeometryRaw (SDL 2.0.18+) instead of
+ * a GL 3.3 core context, so it starts without loading a GL driver when the renderer doesn't
+ * need one (the software renderer never does). Prefixed nk_sdlr_ so both can live in one TU. */
+#include <SDL2/SDL.h>
+
+/* Where the context (without memory) and the convert buffers get their heap memory from; malloc
+ * by default. Set before nk_sdlr_init, which keeps a copy. */
+NK_API void                 nk_sdlr_set_allocator(const struct nk_allocator *alloc);
+/* With memory, the context runs on that fixed arena (nk_init_fixed) instead of malloc */
+NK_API struct nk_context*   nk_sdlr_init(SDL_Window *win, SDL_Renderer *renderer, void *memory, nk_size size);
+NK_API void                 nk_sdlr_font_stash_begin(struct nk_font_atlas **atlas);
+NK_API void                 nk_sdlr_font_stash_end(void);
+/* Draws the stashed font at this height without rebaking */
+NK_API void                 nk_sdlr_set_font_height(float height);
+NK_API int                  nk_sdlr_handle_event(SDL_Event *evt);
+NK_API void                 nk_sdlr_render(enum nk_anti_aliasing);
+NK_API void                 nk_sdlr_shutdown(void);
+/* nk_convert's draw commands go to a fixed buffer that doubles whenever a frame overflows it */
+NK_API void                 nk_sdlr_cmds_usage(nk_size *high_water, nk_size *size);
+
+#endif
+
+/*
+ * ==============================================================
+ *
+ *                          IMPLEMENTATION
+ *
+ * ===============================================================
+ */
+#ifdef NK_SDL_RENDERER_IMPLEMENTATION
+
+#include <string.h>
+
+#ifndef NK_SDLR_CMDS_SIZE
+#define NK_SDLR_CMDS_SIZE (16 * 1024)
+#endif
+
+struct nk_sdlr_device {
+    /* Kept across frames and cleared rather than freed, so they settle at the biggest frame */
+    struct nk_buffer cmds, vbuf, ebuf;
+    void *cmds_memory;
+    nk_size cmds_high_water;
+    struct nk_draw_null_texture null;
+    SDL_Texture *font_tex;
+};
+
+struct nk_sdlr_vertex {
+    float position[2];
+    float uv[2];
+    nk_byte col[4]; /* Laid out like SDL_Color */
+};
+
+static struct nk_sdlr {
+    SDL_Window *win;
+    SDL_Renderer *renderer;
+    struct nk_sdlr_device dev;
+    struct nk_context ctx;
+    struct nk_font_atlas atlas;
+    struct nk_allocator alloc;
+} sdlr;
+
+NK_INTERN struct nk_allocator*
+nk_sdlr_allocator(void)
+{
+    if (!sdlr.alloc.alloc) {
+        sdlr.alloc.alloc = nk_malloc;
+        sdlr.alloc.free = nk_mfree;
+    }
+    return &sdlr.alloc;
+}
+
+NK_API void
+nk_sdlr_set_allocator(const struct nk_allocator *alloc)
+{
+    sdlr.alloc = *alloc;
+}
+
+NK_INTERN void
+nk_sdlr_cmds_resize(struct nk_sdlr_device *dev, nk_size size)
+{
+    struct nk_allocator *alloc = nk_sdlr_allocator();
+    if (dev->cmds_memory)
+        alloc->free(alloc->userdata, dev->cmds_memory);
+    dev->cmds_memory = alloc->alloc(alloc->userdata, 0, size);
+    nk_buffer_init_fixed(&dev->cmds, dev->cmds_memory, size);
+}
+
+NK_API void
+nk_sdlr_cmds_usage(nk_size *high_water, nk_size *size)
+{
+    *high_water = sdlr.dev.cmds_high_water;
+    *size = sdlr.dev.cmds.memory.size;
+}
+
+NK_API void
+nk_sdlr_render(enum nk_anti_aliasing AA)
+{
+    struct nk_sdlr_device *dev = &sdlr.dev;
+    int width, height, display_width, display_height;
+    const struct nk_draw_command *cmd;
+    const nk_draw_index *offset = NULL;
+    const nk_byte *vertices;
+    int vertex_count;
+    struct nk_convert_config config;
+    static const struct nk_draw_vertex_layout_element vertex_layout[] = {
+        {NK_VERTEX_POSITION, NK_FORMAT_FLOAT, NK_OFFSETOF(struct nk_sdlr_vertex, position)},
+        {NK_VERTEX_TEXCOORD, NK_FORMAT_FLOAT, NK_OFFSETOF(struct nk_sdlr_vertex, uv)},
+        {NK_VERTEX_COLOR, NK_FORMAT_R8G8B8A8, NK_OFFSETOF(struct nk_sdlr_vertex, col)},
+        {NK_VERTEX_LAYOUT_END}
+    };
+    const int stride = (int)sizeof(struct nk_sdlr_vertex);
+
+    /* nuklear lays out in window coordinates; on HiDPI the output is bigger */
+    SDL_GetWindowSize(sdlr.win, &width, &height);
+    SDL_GetRendererOutputSize(sdlr.renderer, &display_width, &display_height);
+    SDL_RenderSetScale(sdlr.renderer, (float)display_width/(float)width, (float)display_height/(float)height);
+
+    NK_MEMSET(&config, 0, sizeof(config));
+    config.vertex_layout = vertex_layout;
+    config.vertex_size = sizeof(struct nk_sdlr_vertex);
+    config.vertex_alignment = NK_ALIGNOF(struct nk_sdlr_vertex);
+    config.null = dev->null;
+    config.circle_segment_count = 22;
+    config.curve_segment_count = 22;
+    config.arc_segment_count = 22;
+    config.global_alpha = 1.0f;
+    config.shape_AA = AA;
+    config.line_AA = AA;
+
+    for (;;) {
+        nk_buffer_clear(&dev->cmds);
+        nk_buffer_clear(&dev->vbuf);
+        nk_buffer_clear(&dev->ebuf);
+        if (!(nk_convert(&sdlr.ctx, &dev->cmds, &dev->vbuf, &dev->ebuf, &config) & NK_CONVERT_COMMAND_BUFFER_FULL))
+            break;
+        nk_sdlr_cmds_resize(dev, NK_MAX(dev->cmds.memory.size * 2, NK_SDLR_CMDS_SIZE));
+    }
+    /* Draw commands are pushed onto the back of the buffer */
+    dev->cmds_high_water = NK_MAX(dev->cmds_high_water, dev->cmds.memory.size - dev->cmds.size);
+
+    vertices = (const nk_byte*)nk_buffer_memory_const(&dev->vbuf);
+    vertex_count = (int)(dev->vbuf.needed / sizeof(struct nk_sdlr_vertex));
+    offset = (const nk_draw_index*)nk_buffer_memory_const(&dev->ebuf);
+    nk_draw_foreach(cmd, &sdlr.ctx, &dev->cmds) {
+        SDL_Rect clip;
+        if (!cmd->elem_count) continue;
+        clip.x = (int)cmd->clip_rect.x;
+        clip.y = (int)cmd->clip_rect.y;
+        clip.w = (int)cmd->clip_rect.w;
+        clip.h = (int)cmd->clip_rect.h;
+        SDL_RenderSetClipRect(sdlr.renderer, &clip);
+        SDL_RenderGeometryRaw(sdlr.renderer, (SDL_Texture*)cmd->texture.ptr,
+            (const float*)(vertices + NK_OFFSETOF(struct nk_sdlr_vertex, position)), stride,
+            (const SDL_Color*)(vertices + NK_OFFSETOF(struct nk_sdlr_vertex, col)), stride,
+            (const float*)(vertices + NK_OFFSETOF(struct nk_sdlr_vertex, uv)), stride,
+            vertex_count, offset, (int)cmd->elem_count, (int)sizeof(nk_draw_index));
+        offset += cmd->elem_count;
+    }
+    SDL_RenderSetClipRect(sdlr.renderer, NULL);
+    nk_clear(&sdlr.ctx);
+}
+
+static void
+nk_sdlr_clipboard_paste(nk_handle usr, struct nk_text_edit *edit)
+{
+    const char *text = SDL_GetClipboardText();
+    if (text) nk_textedit_paste(edit, text, nk_strlen(text));
+    (void)usr;
+}
+
+static void
+nk_sdlr_clipboard_copy(nk_handle usr, const char *text, int len)
+{
+    char *str = 0;
+    (void)usr;
+    if (!len) return;
+    str = (char*)malloc((size_t)len+1);
+    if (!str) return;
+    memcpy(str, text, (size_t)len);
+    str[len] = '\0';
+    SDL_SetClipboardText(str);
+    free(str);
+}
+
+NK_API struct nk_context*
+nk_sdlr_init(SDL_Window *win, SDL_Renderer *renderer, void *memory, nk_size size)
+{
+    sdlr.win = win;
+    sdlr.renderer = renderer;
+    if (memory)
+        nk_init_fixed(&sdlr.ctx, memory, size, 0);
+    else nk_init(&sdlr.ctx, nk_sdlr_allocator(), 0);
+    sdlr.ctx.clip.copy = nk_sdlr_clipboard_copy;
+    sdlr.ctx.clip.paste = nk_sdlr_clipboard_paste;
+    sdlr.ctx.clip.userdata = nk_handle_ptr(0);
+    nk_sdlr_cmds_resize(&sdlr.dev, NK_SDLR_CMDS_SIZE);
+    nk_buffer_init(&sdlr.dev.vbuf, nk_sdlr_allocator(), NK_BUFFER_DEFAULT_INITIAL_SIZE);
+    nk_buffer_init(&sdlr.dev.ebuf, nk_sdlr_allocator(), NK_BUFFER_DEFAULT_INITIAL_SIZE);
+    return &sdlr.ctx;
+}
+
+NK_API void
+nk_sdlr_font_stash_begin(struct nk_font_atlas **atlas)
+{
+    nk_font_atlas_init_default(&sdlr.atlas);
+    nk_font_atlas_begin(&sdlr.atlas);
+    *atlas = &sdlr.atlas;
+}
+
+NK_API void
+nk_sdlr_font_stash_end(void)
+{
+    const void *image; int w, h;
+    image = nk_font_atlas_bake(&sdlr.atlas, &w, &h, NK_FONT_ATLAS_RGBA32);
+    sdlr.dev.font_tex = SDL_CreateTexture(sdlr.renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, w, h);
+    if (sdlr.dev.font_tex) {
+        SDL_UpdateTexture(sdlr.dev.font_tex, NULL, image, w * 4);
+        SDL_SetTextureBlendMode(sdlr.dev.font_tex, SDL_BLENDMODE_BLEND);
+    }
+    nk_font_atlas_end(&sdlr.atlas, nk_handle_ptr(sdlr.dev.font_tex), &sdlr.dev.null);
+    if (sdlr.atlas.default_font)
+        nk_style_set_font(&sdlr.ctx, &sdlr.atlas.default_font->handle);
+}
+
+NK_API void
+nk_sdlr_set_font_height(float height)
+{
+    if (!sdlr.atlas.default_font) return;
+    sdlr.atlas.default_font->handle.height = height;
+    nk_style_set_font(&sdlr.ctx, &sdlr.atlas.default_font->handle);
+}
+
+NK_API int
+nk_sdlr_handle_event(SDL_Event *evt)
+{
+    struct nk_context *ctx = &sdlr.ctx;
+    if (evt->type == SDL_KEYUP || evt->type == SDL_KEYDOWN) {
+        /* key events */
+        int down = evt->type == SDL_KEYDOWN;
+        const Uint8* state = SDL_GetKeyboardState(0);
+        SDL_Keycode sym = evt->key.keysym.sym;
+        if (sym == SDLK_RSHIFT || sym == SDLK_LSHIFT)
+            nk_input_key(ctx, NK_KEY_SHIFT, down);
+        else if (sym == SDLK_DELETE)
+            nk_input_key(ctx, NK_KEY_DEL, down);
+        else if (sym == SDLK_RETURN)
+            nk_input_key(ctx, NK_KEY_ENTER, down);
+        else if (sym == SDLK_TAB)
+            nk_input_key(ctx, NK_KEY_TAB, down);
+        else if (sym == SDLK_BACKSPACE)
+            nk_input_key(ctx, NK_KEY_BACKSPACE, down);
+        else if (sym == SDLK_HOME) {
+            nk_input_key(ctx, NK_KEY_TEXT_START, down);
+            nk_input_key(ctx, NK_KEY_SCROLL_START, down);
+        } else if (sym == SDLK_END) {
+            nk_input_key(ctx, NK_KEY_TEXT_END, down);
+            nk_input_key(ctx, NK_KEY_SCROLL_END, down);
+        } else if (sym == SDLK_PAGEDOWN) {
+            nk_input_key(ctx, NK_KEY_SCROLL_DOWN, down);
+        } else if (sym == SDLK_PAGEUP) {
+            nk_input_key(ctx, NK_KEY_SCROLL_UP, down);
+        } else if (sym == SDLK_z)
+            nk_input_key(ctx, NK_KEY_TEXT_UNDO, down && state[SDL_SCANCODE_LCTRL]);
+        else if (sym == SDLK_r)
+            nk_input_key(ctx, NK_KEY_TEXT_REDO, down && state[SDL_SCANCODE_LCTRL]);
+        else if (sym == SDLK_c)
+            nk_input_key(ctx, NK_KEY_COPY, down && state[SDL_SCANCODE_LCTRL]);
+        else if (sym == SDLK_v)
+            nk_input_key(ctx, NK_KEY_PASTE, down && state[SDL_SCANCODE_LCTRL]);
+        else if (sym == SDLK_x)
+            nk_input_key(ctx, NK_KEY_CUT, down && state[SDL_SCANCODE_LCTRL]);
+        else if (sym == SDLK_b)
+            nk_input_key(ctx, NK_KEY_TEXT_LINE_START, down && state[SDL_SCANCODE_LCTRL]);
+        else if (sym == SDLK_e)
+            nk_input_key(ctx, NK_KEY_TEXT_LINE_END, down && state[SDL_SCANCODE_LCTRL]);
+        else if (sym == SDLK_UP)
+            nk_input_key(ctx, NK_KEY_UP, down);
+        else if (sym == SDLK_DOWN)
+            nk_input_key(ctx, NK_KEY_DOWN, down);
+        else if (sym == SDLK_LEFT) {
+            if (state[SDL_SCANCODE_LCTRL])
+                nk_input_key(ctx, NK_KEY_TEXT_WORD_LEFT, down);
+            else nk_input_key(ctx, NK_KEY_LEFT, down);
+        } else if (sym == SDLK_RIGHT) {
+            if (state[SDL_SCANCODE_LCTRL])
+                nk_input_key(ctx, NK_KEY_TEXT_WORD_RIGHT, down);
+            else nk_input_key(ctx, NK_KEY_RIGHT, down);
+        } else return 0;
+        return 1;
+    } else if (evt->type == SDL_MOUSEBUTTONDOWN || evt->type == SDL_MOUSEBUTTONUP) {
+        /* mouse button */
+        int down = evt->type == SDL_MOUSEBUTTONDOWN;
+        const int x = evt->button.x, y = evt->button.y;
+        if (evt->button.button == SDL_BUTTON_LEFT) {
+            if (evt->button.clicks > 1)
+                nk_input_button(ctx, NK_BUTTON_DOUBLE, x, y, down);
+            nk_input_button(ctx, NK_BUTTON_LEFT, x, y, down);
+        } else if (evt->button.button == SDL_BUTTON_MIDDLE)
+            nk_input_button(ctx, NK_BUTTON_MIDDLE, x, y, down);
+        else if (evt->button.button == SDL_BUTTON_RIGHT)
+            nk_input_button(ctx, NK_BUTTON_RIGHT, x, y, down);
+        return 1;
+    } else if (evt->type == SDL_MOUSEMOTION) {
+        /* mouse motion */
+        if (ctx->input.mouse.grabbed) {
+            int x = (int)ctx->input.mouse.prev.x, y = (int)ctx->input.mouse.prev.y;
+            nk_input_motion(ctx, x + evt->motion.xrel, y + evt->motion.yrel);
+        } else nk_input_motion(ctx, evt->motion.x, evt->motion.y);
+        return 1;
+    } else if (evt->type == SDL_TEXTINPUT) {
+        /* text input */
+        nk_glyph glyph;
+        memcpy(glyph, evt->text.text, NK_UTF_SIZE);
+        nk_input_glyph(ctx, glyph);
+        return 1;
+    } else if (evt->type == SDL_MOUSEWHEEL) {
+        /* mouse wheel */
+        nk_input_scroll(ctx,nk_vec2((float)evt->wheel.x,(float)evt->wheel.y));
+        return 1;
+    }
+    return 0;
+}
+
+NK_API
+void nk_sdlr_shutdown(void)
+{
+    nk_font_atlas_clear(&sdlr.atlas);
+    nk_free(&sdlr.ctx);
+    if (sdlr.dev.font_tex)
+        SDL_DestroyTexture(sdlr.dev.font_tex);
+    if (sdlr.dev.cmds_memory)
+        sdlr.alloc.free(sdlr.alloc.userdata, sdlr.dev.cmds_memory);
+    nk_buffer_free(&sdlr.dev.vbuf);
+    nk_buffer_free(&sdlr.dev.ebuf);
+    memset(&sdlr, 0, sizeof(sdlr));
+}
+
+#endif
@@ -0,0 +1,80 @@
+/* Thin client for volund's control socket. Meant to be bound to a hotkey, so it stays in plain C
+ * and does nothing but connect, send one request and print the reply.
+ *
+ *   volund-msg toggle
+ *   volund-msg show [query]
+ *   volund-msg reload
+ *   volund-msg stats
+ *   volund-msg query <text> */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Protocol.h"
+
+static int io_all(int fd, void* buf, size_t len, int writing) {
+    char* bytes = buf;
+    while (len) {
+        ssize_t n = writing ? write(fd, bytes, len) : read(fd, bytes, len);
+        if (n <= 0)
+            return 0;
+        bytes += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+static int usage(void) {
+    fputs("usage: volund-msg toggle | show [query] | reload | stats | query <text>\n", stderr);
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2)
+        return usage();
+
+    static const struct {
+        const char* name;
+        uint8_t     op;
+    } ops[] = {{"toggle", VOLUND_OP_TOGGLE}, {"show", VOLUND_OP_SHOW}, {"reload", VOLUND_OP_RELOAD}, {"stats", VOLUND_OP_STATS}, {"query", VOLUND_OP_QUERY}};
+
+    uint8_t op = 0;
+    for (size_t i = 0; i < sizeof(ops) / sizeof(*ops); i++)
+        if (strcmp(argv[1], ops[i].name) == 0)
+            op = ops[i].op;
+    if (!op || (op == VOLUND_OP_QUERY && argc < 3))
+        return usage();
+
+    const char*              payload = argc > 2 ? argv[2] : "";
+    struct volund_msg_header req     = {op, 0, 0, (uint32_t)strlen(payload)};
+
+    struct sockaddr_un addr = {0};
+    addr.sun_family         = AF_UNIX;
+    volund_socket_path(addr.sun_path, sizeof(addr.sun_path));
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "volund-msg: can't reach volund at %s\n", addr.sun_path);
+        return 1;
+    }
+
+    struct volund_msg_header res;
+    if (!io_all(fd, &req, sizeof(req), 1) || !io_all(fd, (void*)payload, req.length, 1) || !io_all(fd, &res, sizeof(res), 0)) {
+        fputs("volund-msg: connection dropped\n", stderr);
+        return 1;
+    }
+
+    char buf[4096];
+    for (uint32_t left = res.length; left;) {
+        size_t chunk = left < sizeof(buf) ? left : sizeof(buf);
+        if (!io_all(fd, buf, chunk, 0))
+            return 1;
+        fwrite(buf, 1, chunk, res.status == VOLUND_STATUS_OK ? stdout : stderr);
+        left -= (uint32_t)chunk;
+    }
+    close(fd);
+    return res.status == VOLUND_STATUS_OK ? 0 : 1;
+}